@@ -53,8 +53,9 @@
 // BOD:        BOD disabled
 // Timing:     Micros disabled
 // Leave the rest on default settings. Don't forget to "Burn bootloader"!
-// No Arduino core functions or libraries are used. Use the makefile to
-// compile without Arduino IDE.
+// No Arduino core functions are used. The I2C and OLED driver is the tinyOLED
+// library (software/tinyOLED), copy it into your Arduino libraries folder.
+// Use the makefile to compile without Arduino IDE.
 //
 // A big thank you to Ralph Doncaster (nerdralph) for his optimization tips.
 // ( https://nerdralph.blogspot.com/ , https://github.com/nerdralph )
@@ -65,9 +66,11 @@
 // License: http://creativecommons.org/licenses/by-sa/3.0/
 
 
-// Select the screen size
+// Select the screen size (or SCREEN = ... in the makefile)
+#if !defined(SCREEN_128x32) && !defined(SCREEN_128x64)
 #define SCREEN_128x32
 //#define SCREEN_128x64
+#endif
 
 
 #if defined(SCREEN_128x32) and defined(SCREEN_128x64)
@@ -77,90 +80,39 @@
 #error "Please define one of SCREEN_128x32 or SCREEN_128x64!"
 #endif
 
-// Libraries
-#include <avr/io.h>
-#include <avr/pgmspace.h>
+// OLED settings
+//#define OLED_FLIP                           // uncomment to flip the screen
+//#define OLED_FASTBOOT                       // short power-up wait, display on after the first frame
+#define OLED_MODE       OLED_VERTICAL         // memory addressing mode of the init sequence
 
 // Pin definitions
 #define I2C_SDA         PB0                   // serial data pin
 #define I2C_SCL         PB2                   // serial clock pin
+//#define I2C_SDA2        PB1                   // data pin of a second OLED (same picture)
 
-// -----------------------------------------------------------------------------
-// I2C Master Implementation (Write only)
-// -----------------------------------------------------------------------------
+// I2C_write implementation: uncomment for the hand-scheduled assembly version
+//#define I2C_ASM                             // unrolled, fixed cycle counts, ~80 bytes more flash
 
-// I2C macros
-#define I2C_SDA_HIGH()  DDRB &= ~(1<<I2C_SDA) // release SDA   -> pulled HIGH by resistor
-#define I2C_SDA_LOW()   DDRB |=  (1<<I2C_SDA) // SDA as output -> pulled LOW  by MCU
-#define I2C_SCL_HIGH()  DDRB &= ~(1<<I2C_SCL) // release SCL   -> pulled HIGH by resistor
-#define I2C_SCL_LOW()   DDRB |=  (1<<I2C_SCL) // SCL as output -> pulled LOW  by MCU
-
-// I2C init function
-void I2C_init(void) {
-  DDRB  &= ~((1<<I2C_SDA)|(1<<I2C_SCL));  // pins as input (HIGH-Z) -> lines released
-  PORTB &= ~((1<<I2C_SDA)|(1<<I2C_SCL));  // should be LOW when as ouput
-}
-
-// I2C transmit one data byte to the slave, ignore ACK bit, no clock stretching allowed
-void I2C_write(uint8_t data) {
-  for(uint8_t i = 8; i; i--) {            // transmit 8 bits, MSB first
-    I2C_SDA_LOW();                        // SDA LOW for now (saves some flash this way)
-    if (data & 0x80) I2C_SDA_HIGH();      // SDA HIGH if bit is 1
-    I2C_SCL_HIGH();                       // clock HIGH -> slave reads the bit
-    data<<=1;                             // shift left data byte, acts also as a delay
-    I2C_SCL_LOW();                        // clock LOW again
-  }
-  I2C_SDA_HIGH();                         // release SDA for ACK bit of slave
-  I2C_SCL_HIGH();                         // 9th clock pulse is for the ACK bit
-  asm("nop");                             // ACK bit is ignored, just a delay
-  I2C_SCL_LOW();                          // clock LOW again
-}
+// I2C error handling: uncomment to check the ACK of the OLED address
+//#define I2C_ACKCHECK                        // skip frames and recover the bus if it is missing
 
-// I2C start transmission
-void I2C_start(uint8_t addr) {
-  I2C_SDA_LOW();                          // start condition: SDA goes LOW first
-  I2C_SCL_LOW();                          // start condition: SCL goes LOW second
-  I2C_write(addr);                        // send slave address
-}
+// Big digits: scale factor of the 3x8 font (2, 3 or 4), a digit is 8 * DIGIT_SCALE
+// pixels high and 4 * DIGIT_SCALE columns wide
+#define DIGIT_SCALE     4                     // 4: 32 pixels, the whole 128x32 screen
 
-// I2C stop transmission
-void I2C_stop(void) {
-  I2C_SDA_LOW();                          // prepare SDA for LOW to HIGH transition
-  I2C_SCL_HIGH();                         // stop condition: SCL goes HIGH first
-  I2C_SDA_HIGH();                         // stop condition: SDA goes HIGH second
-}
+// Instrumentation: uncomment to toggle a spare pin after every frame (scope timing)
+//#define PERF_PIN        PB1                   // timing pin (PB1 or PB3)
 
-// -----------------------------------------------------------------------------
-// OLED Implementation
-// -----------------------------------------------------------------------------
+// Instrumentation: uncomment to count I2C bytes, transactions and frames per second
+//#define PERF_COUNT
 
-// OLED definitions
-#define OLED_ADDR       0x78                  // OLED write address
-#define OLED_CMD_MODE   0x00                  // set command mode
-#define OLED_DAT_MODE   0x40                  // set data mode
-#if defined(SCREEN_128x32)
-#define OLED_INIT_LEN   12                    // 12: no screen flip, 14: screen flip
-#define MULTIPLEX 0x1F
-#else
-#define OLED_INIT_LEN   7                     // 7: no screen flip, 9: screen flip
-#define MULTIPLEX 0x3F
-#endif
+// Frame scheduler: uncomment to sleep between the frames (battery operation)
+//#define FRAME_FPS       30                    // frame rate, rounded to 31, 16, 8 ... fps
 
-// OLED init settings
-const uint8_t OLED_INIT_CMD[] PROGMEM = {
-  0xA8, MULTIPLEX,  // set multiplex (HEIGHT-1): 0x1F for 128x32, 0x3F for 128x64
-  0x20, 0x01,       // set vertical memory addressing mode
-//  0x22, 0x00, 0x03, // set min and max page => set in OLED_init
-#if defined(SCREEN_128x32)
-  0xDA, 0x02,       // set COM pins hardware configuration to sequential
-#endif
-  0x8D, 0x14,       // enable charge pump
-  0xAF,             // switch on OLED
-#if defined(SCREEN_128x32)
-  0x00, 0x10, 0xB0, // set cursor at home position
-#endif
-  0xA1, 0xC8        // flip the screen
-};
+// Libraries
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <tinyOLED.h>                         // I2C and OLED driver (software/tinyOLED)
 
 // Simple reduced 3x8 font
 const uint8_t OLED_FONT[] PROGMEM = {
@@ -186,69 +138,97 @@ const uint8_t OLED_FONT[] PROGMEM = {
   0x00, 0x00, 0x00  //   19
 };
 
-// OLED init function
-void OLED_init(void) {
-  I2C_init();                             // initialize I2C first
-  I2C_start(OLED_ADDR);                   // start transmission to OLED
-  I2C_write(OLED_CMD_MODE);               // set command mode
-  for (uint8_t i = 0; i < OLED_INIT_LEN; i++) I2C_write(pgm_read_byte(&OLED_INIT_CMD[i])); // send the command bytes
-  I2C_stop();                             // stop transmission
+// OLED shadow copy of the digits currently shown on the screen
+uint8_t OLED_shadow[8];
 
-  // For the 128x64 screen, we'll only use half the height (vertically centered), so clear the whole screen
-#if defined(SCREEN_128x64)
-  I2C_start(OLED_ADDR);                   // start transmission to OLED
-  I2C_write(OLED_DAT_MODE);               // set data mode
-  for(uint16_t i=1024; i; i--) I2C_write(0x00);
-  I2C_stop();                             // stop transmission
+// Big digit geometry
+#if DIGIT_SCALE < 2 || DIGIT_SCALE > 4
+#error "DIGIT_SCALE must be 2, 3 or 4!"
 #endif
+#define DIGIT_WIDTH     (4 * DIGIT_SCALE)     // columns per digit
+#define DIGIT_GAP       (DIGIT_SCALE - DIGIT_SCALE / 2) // spacing columns between digits
+#define DIGIT_XPOS      ((128 - 8 * DIGIT_WIDTH) / 2) // center the 8 digits ...
+#define DIGIT_YPOS      ((OLED_PAGES - DIGIT_SCALE) / 2) // ... horizontally and vertically
 
-  // Set min and max pages. Probably not required for 128x32 since we
-  // use the whole height.
-  I2C_start(OLED_ADDR);
-  I2C_write(OLED_CMD_MODE);
-  I2C_write(0x22);
-#if defined(SCREEN_128x32)
-  I2C_write(0x00);
-  I2C_write(0x03);
-#else // Center vertically for 128x64 screen
-  I2C_write(0x02);
-  I2C_write(0x05);
+// Stretch table: every bit of the table index is repeated DIGIT_SCALE times.
+// With 4x each entry covers 2 font bits and gives one byte, with 2x 4 bits.
+// With 3x a nibble gives 12 bits, two of them make the 3 bytes of a column.
+#define STRETCH_BIT(v, n) ((((v) >> (n)) & 1) ? ((1u << DIGIT_SCALE) - 1) << ((n) * DIGIT_SCALE) : 0)
+#define STRETCH(v)      (STRETCH_BIT(v, 0) | STRETCH_BIT(v, 1) | STRETCH_BIT(v, 2) | STRETCH_BIT(v, 3))
+#define STRETCH4(v)     STRETCH(v), STRETCH(v + 1), STRETCH(v + 2), STRETCH(v + 3)
+#if DIGIT_SCALE == 4
+#define STRETCH_BITS    2                     // font bits per table entry
+const uint8_t  OLED_STRETCH[] PROGMEM = { STRETCH4(0) };
+#elif DIGIT_SCALE == 3
+const uint16_t OLED_STRETCH[] PROGMEM = { STRETCH4(0), STRETCH4(4), STRETCH4(8), STRETCH4(12) };
+#else
+#define STRETCH_BITS    4                     // font bits per table entry
+const uint8_t  OLED_STRETCH[] PROGMEM = { STRETCH4(0), STRETCH4(4), STRETCH4(8), STRETCH4(12) };
 #endif
-  I2C_stop();
-}
+#define STRETCH_MASK    ((1 << STRETCH_BITS) - 1)
 
-// OLED stretch a part of a byte
-uint8_t OLED_stretch(uint8_t b) {
-  b  = ((b & 2) << 3) | (b & 1);          // split 2 LSB into the nibbles
-  b |= b << 1;                            // double the bits
-  b |= b << 2;                            // double them again = 4 times
-  return b;                               // return the value
-}
-
-// OLED print a big digit
+// OLED print a big digit. The stretched bytes of a font column are computed
+// once and then sent for all columns that repeat it (x-direction).
 void OLED_printD(uint8_t ch) {
   uint8_t i, j, k, b;                     // loop variables
-  uint8_t sb[4];                          // stretched character bytes
+  uint8_t sb[DIGIT_SCALE];                // stretched character bytes
   ch += ch << 1;                          // calculate position of character in font array
-  for(i=8; i; i--) I2C_write(0x00);       // print spacing between characters
+  for(i=DIGIT_GAP * DIGIT_SCALE; i; i--) I2C_write(0x00); // print spacing between characters
   for(i=3; i; i--) {                      // font has 3 bytes per character
     b = pgm_read_byte(&OLED_FONT[ch++]);  // read character byte
-    for(j=0; j<4; j++, b >>= 2) sb[j] = OLED_stretch(b);  // stretch 4 times
-    j=4; if(i==2) j=6;                    // calculate x-stretch value
-    while(j--) {                       // write several times (x-direction)
-      for(k=0; k<4; k++) I2C_write(sb[k]);// the 4 stretched bytes (y-direction)
+#if DIGIT_SCALE == 3
+    uint32_t s = pgm_read_word(&OLED_STRETCH[b & 0x0F]) | ((uint32_t)pgm_read_word(&OLED_STRETCH[b >> 4]) << 12);
+    for(j=0; j<3; j++, s >>= 8) sb[j] = s;  // split the 24 stretched bits
+#else
+    for(j=0; j<DIGIT_SCALE; j++, b >>= STRETCH_BITS) sb[j] = pgm_read_byte(&OLED_STRETCH[b & STRETCH_MASK]); // stretch via table
+#endif
+    j = DIGIT_SCALE;                      // calculate x-stretch value ...
+    if(i==2) j += DIGIT_SCALE / 2;        // ... the middle column is wider
+    while(j--) {                          // write several times (x-direction)
+      for(k=0; k<DIGIT_SCALE; k++) I2C_write(sb[k]); // the stretched bytes (y-direction)
     }
   } 
 }
 
-// OLED print buffer
-void OLED_printB(uint8_t *buffer) {
-  I2C_start(OLED_ADDR);                   // start transmission to OLED
-  I2C_write(OLED_DAT_MODE);               // set data mode
-  for(uint8_t i=0; i<8; i++) OLED_printD(buffer[i]);  // print buffer
+// OLED set the column/page window over the digit positions first to last
+void OLED_window(uint8_t first, uint8_t last) {
+  uint8_t pos = DIGIT_XPOS + first * DIGIT_WIDTH; // start column of first digit
+  OLED_START(return);                     // start transmission to OLED
+  I2C_write(OLED_CMD_MODE);               // set command mode
+  I2C_write(0x21);                        // set column address window ...
+  I2C_write(pos);                         // ... start column
+  I2C_write(DIGIT_XPOS + last * DIGIT_WIDTH + DIGIT_WIDTH - 1); // ... end column of last digit
+  I2C_write(0x22);                        // set page address window ...
+  I2C_write(DIGIT_YPOS);                  // ... start page
+  I2C_write(DIGIT_YPOS + DIGIT_SCALE - 1); // ... end page
   I2C_stop();                             // stop transmission
 }
 
+// OLED print buffer: only the digits that have changed since the last call
+// are sent, a run of neighboring digits with one window and one transaction.
+// Returns the changed digits as a bit mask (bit i = digit i).
+uint8_t OLED_printB(uint8_t *buffer) {
+  uint8_t changed = 0;                    // changed digits
+  uint8_t i = 0, j;
+  while(i < 8) {                          // check each digit of the buffer
+    if(buffer[i] == OLED_shadow[i]) {     // digit unchanged? -> skip it
+      i++; continue;
+    }
+    j = i;                                // find the end of the run of changed digits
+    while((j < 7) && (buffer[j+1] != OLED_shadow[j+1])) j++;
+    OLED_window(i, j);                    // move window onto these digits
+    OLED_START(return changed);           // start transmission to OLED
+    I2C_write(OLED_DAT_MODE);             // set data mode
+    for(; i<=j; i++) {                    // the digits follow each other in the window
+      OLED_printD(buffer[i]);             // print the digit
+      OLED_shadow[i] = buffer[i];         // remember what is on the screen now
+      changed |= 1 << i;                  // report this digit
+    }
+    I2C_stop();                           // stop transmission
+  }
+  return changed;
+}
+
 // -----------------------------------------------------------------------------
 // Main Function
 // -----------------------------------------------------------------------------
@@ -260,22 +240,32 @@ int main(void) {
   
   // Setup
   OLED_init();                            // initialize the OLED
+  for(uint8_t i=0; i<8; i++) OLED_shadow[i] = 0xFF; // force a full redraw on first print
+#if defined(SCREEN_128x64) || (DIGIT_SCALE < 4)
+  OLED_clear();                           // only a part of the screen is used, so clear the whole screen
+#endif
+  PERF_init();                            // initialize instrumentation
+  FRAME_init();                           // initialize frame scheduler
 
   // Loop
   while(1) {                              // loop until forever                         
+    FRAME_wait();                         // sleep until the next frame is due
     OLED_printB(buffer);                  // print screen buffer
+    PERF_frame();                         // frame done (instrumentation)
+    OLED_ready();                         // display on after the first frame
     counter_a++;                          // increase counter a
+    buffer[7] = counter_a & 0x0F;         // low nibble of counter a
+    buffer[6] = counter_a >> 4;           // high nibble of counter a
     if(!counter_a) {                      // if counter a overflows:
       counter_b++;                        // increase counter b
-      if (!counter_b) counter_c++;        // if counter b overflows increase counter c
+      buffer[4] = counter_b & 0x0F;       // low nibble of counter b
+      buffer[3] = counter_b >> 4;         // high nibble of counter b
+      if(!counter_b) {                    // if counter b overflows:
+        counter_c++;                      // increase counter c
+        buffer[1] = counter_c & 0x0F;     // low nibble of counter c
+        buffer[0] = counter_c >> 4;       // high nibble of counter c
+      }
     }
-    buffer[7] = counter_a & 0x0F;         // low nibble of counter a
-    buffer[6] = counter_a >> 4;           // high nibble of counter a
-    buffer[4] = counter_b & 0x0F;         // low nibble of counter b
-    buffer[3] = counter_b >> 4;           // high nibble of counter b
-    buffer[1] = counter_c & 0x0F;         // low nibble of counter c
-    buffer[0] = counter_c >> 4;           // high nibble of counter c
-    buffer[2] = 19;                       // set space between c and b for now
-    if(counter_a & 0x20) buffer[2] = 17;  // toggle ':' at this position
+    buffer[2] = (counter_a & 0x20) ? 17 : 19; // toggle ':' at this position
   }
 }
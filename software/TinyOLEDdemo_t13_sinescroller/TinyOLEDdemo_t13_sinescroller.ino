@@ -38,8 +38,9 @@
 // Timing:      Micros disabled
 //
 // Leave the rest on default settings. Don't forget to "Burn bootloader"!
-// No Arduino core functions or libraries are used. Use the makefile if 
-// you want to compile without Arduino IDE.
+// No Arduino core functions are used. The I2C and OLED driver is the tinyOLED
+// library (software/tinyOLED), copy it into your Arduino libraries folder.
+// Use the makefile if you want to compile without Arduino IDE.
 //
 // Fuse settings: -U lfuse:w:0x3a:m -U hfuse:w:0xff:m
 
@@ -48,13 +49,59 @@
 // Libraries and Definitions
 // ===================================================================================
 
-// Libraries
-#include <avr/io.h>
-#include <avr/pgmspace.h>
+// OLED settings
+//#define OLED_FLIP                           // uncomment to flip the screen
+//#define OLED_FASTBOOT                       // short power-up wait, display on after the first frame
+#define OLED_MODE       OLED_VERTICAL         // memory addressing mode of the init sequence
+#define OLED_PRINT                            // 5x8 font
 
 // Pin definitions
 #define I2C_SDA         PB0                   // serial data pin
 #define I2C_SCL         PB2                   // serial clock pin
+//#define I2C_SDA2        PB1                   // data pin of a second OLED (same picture)
+
+// I2C_write implementation: uncomment for the hand-scheduled assembly version
+//#define I2C_ASM                             // unrolled, fixed cycle counts, ~80 bytes more flash
+
+// I2C error handling: uncomment to check the ACK of the OLED address
+//#define I2C_ACKCHECK                        // skip frames and recover the bus if it is missing
+
+// Instrumentation: uncomment to toggle a spare pin after every frame (scope timing)
+//#define PERF_PIN        PB1                   // timing pin (PB1 or PB3)
+
+// Instrumentation: uncomment to count I2C bytes, transactions and frames per second
+//#define PERF_COUNT
+
+// Frame scheduler: uncomment to sleep between the frames (battery operation)
+//#define FRAME_FPS       30                    // frame rate, rounded to 31, 16, 8 ... fps
+
+// Sine wave renderer: uncomment to use a precomputed full wave shift table
+//#define SINE_TABLE                          // faster, ~110 bytes more flash
+
+// Scroll engine: uncomment to let the OLED move the picture with its horizontal
+// scroll, only the new column and the columns the wave changed are sent per step
+// (~110 instead of ~520 bytes). The wave moves against the text more slowly.
+//#define HW_SCROLL                           // SSD1306 commands 0x27, 0x2F and 0x2E
+
+// Font: uncomment to use the font subset generated by "make font" (oled_font.h)
+//#define OLED_FONT_HEADER                        // e.g. only the glyphs of the message
+
+// Font: uncomment for the proportional font, more characters fit on the screen
+//#define OLED_FONT_PROP                        // narrow glyphs without blank columns
+
+// Libraries
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <tinyOLED.h>                         // I2C and OLED driver (software/tinyOLED)
+#if defined(HW_SCROLL)
+#include <util/delay.h>                       // time of one scroll step
+#endif
+#if OLED_PAGES != 4
+#error "This demo draws 4 pages (128x32), use TinyOLEDdemo_t13_sinescroller_128x64.ino for 128x64"
+#endif
+#if defined(OLED_FONT_PACKED)
+#error "Packed font is not supported by OLED_plotChar, use FONTFLAGS = -s"
+#endif
 
 // Message to scroll on OLED
 const char Message[] PROGMEM =
@@ -67,6 +114,12 @@ uint8_t sine_ptr;                             // sine wave table pointer
 uint8_t msg_ptr;                              // message pointer
 uint8_t shift;                                // character shif
 
+#if defined(OLED_FONT_PROP)
+#define CHAR_COLS       OLED_width            // columns of the glyph from OLED_glyph()
+#else
+#define CHAR_COLS       5                     // columns of every glyph
+#endif
+
 // ===================================================================================
 // Sine Wave Look Up Table
 // ===================================================================================
@@ -77,74 +130,22 @@ const uint8_t SINE24[] PROGMEM = {
   0x33, 0x32, 0x22, 0x11, 0x11, 0x00, 0x00, 0x00
 };
 
-// ===================================================================================
-// OLED Font
-// ===================================================================================
+#if defined(SINE_TABLE)
+// Compile-time generator for the full wave shift table (mirrored from SINE24)
+#define SINE_PT(p)      (((p) & 0x20) ? 0x1F - ((p) & 0x1F) : ((p) & 0x1F))
+#define SINE_NIB(pt)    (((pt) & 1) ? (SINE24[(pt)>>1] & 0x0F) : (SINE24[(pt)>>1] >> 4))
+#define SINE_SH(p)      (((p) & 0x40) ? 0x17 - SINE_NIB(SINE_PT(p)) : SINE_NIB(SINE_PT(p)))
+#define SINE_ROW(p)     SINE_SH(p+0), SINE_SH(p+1), SINE_SH(p+2), SINE_SH(p+3), \
+                        SINE_SH(p+4), SINE_SH(p+5), SINE_SH(p+6), SINE_SH(p+7)
 
-// Standard ASCII 5x8 font (adapted from Neven Boyanov and Stephen Denne)
-const uint8_t OLED_FONT[] PROGMEM = {
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2F, 0x00, 0x00, 0x00, 0x07, 0x00, 0x07, 0x00,
-  0x14, 0x7F, 0x14, 0x7F, 0x14, 0x24, 0x2A, 0x7F, 0x2A, 0x12, 0x23, 0x13, 0x08, 0x64, 0x62,
-  0x36, 0x49, 0x55, 0x22, 0x50, 0x00, 0x05, 0x03, 0x00, 0x00, 0x00, 0x1C, 0x22, 0x41, 0x00,
-  0x00, 0x41, 0x22, 0x1C, 0x00, 0x14, 0x08, 0x3E, 0x08, 0x14, 0x08, 0x08, 0x3E, 0x08, 0x08,
-  0x00, 0x00, 0xA0, 0x60, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x60, 0x60, 0x00, 0x00,
-  0x20, 0x10, 0x08, 0x04, 0x02, 0x3E, 0x51, 0x49, 0x45, 0x3E, 0x00, 0x42, 0x7F, 0x40, 0x00,
-  0x42, 0x61, 0x51, 0x49, 0x46, 0x21, 0x41, 0x45, 0x4B, 0x31, 0x18, 0x14, 0x12, 0x7F, 0x10,
-  0x27, 0x45, 0x45, 0x45, 0x39, 0x3C, 0x4A, 0x49, 0x49, 0x30, 0x01, 0x71, 0x09, 0x05, 0x03,
-  0x36, 0x49, 0x49, 0x49, 0x36, 0x06, 0x49, 0x49, 0x29, 0x1E, 0x00, 0x36, 0x36, 0x00, 0x00,
-  0x00, 0x56, 0x36, 0x00, 0x00, 0x08, 0x14, 0x22, 0x41, 0x00, 0x14, 0x14, 0x14, 0x14, 0x14,
-  0x00, 0x41, 0x22, 0x14, 0x08, 0x02, 0x01, 0x51, 0x09, 0x06, 0x32, 0x49, 0x59, 0x51, 0x3E,
-  0x7C, 0x12, 0x11, 0x12, 0x7C, 0x7F, 0x49, 0x49, 0x49, 0x36, 0x3E, 0x41, 0x41, 0x41, 0x22,
-  0x7F, 0x41, 0x41, 0x22, 0x1C, 0x7F, 0x49, 0x49, 0x49, 0x41, 0x7F, 0x09, 0x09, 0x09, 0x01,
-  0x3E, 0x41, 0x49, 0x49, 0x7A, 0x7F, 0x08, 0x08, 0x08, 0x7F, 0x00, 0x41, 0x7F, 0x41, 0x00,
-  0x20, 0x40, 0x41, 0x3F, 0x01, 0x7F, 0x08, 0x14, 0x22, 0x41, 0x7F, 0x40, 0x40, 0x40, 0x40,
-  0x7F, 0x02, 0x0C, 0x02, 0x7F, 0x7F, 0x04, 0x08, 0x10, 0x7F, 0x3E, 0x41, 0x41, 0x41, 0x3E,
-  0x7F, 0x09, 0x09, 0x09, 0x06, 0x3E, 0x41, 0x51, 0x21, 0x5E, 0x7F, 0x09, 0x19, 0x29, 0x46,
-  0x46, 0x49, 0x49, 0x49, 0x31, 0x01, 0x01, 0x7F, 0x01, 0x01, 0x3F, 0x40, 0x40, 0x40, 0x3F,
-  0x1F, 0x20, 0x40, 0x20, 0x1F, 0x3F, 0x40, 0x38, 0x40, 0x3F, 0x63, 0x14, 0x08, 0x14, 0x63,
-  0x07, 0x08, 0x70, 0x08, 0x07, 0x61, 0x51, 0x49, 0x45, 0x43, 0x00, 0x7F, 0x41, 0x41, 0x00,
-  0x02, 0x04, 0x08, 0x10, 0x20, 0x00, 0x41, 0x41, 0x7F, 0x00, 0x04, 0x02, 0x01, 0x02, 0x04,
-  0x40, 0x40, 0x40, 0x40, 0x40
+// Sine wave shift table (full wave, 128 points, shift value 0..23 per point)
+const uint8_t SINE_SHIFT[] PROGMEM = {
+  SINE_ROW(0x00), SINE_ROW(0x08), SINE_ROW(0x10), SINE_ROW(0x18),
+  SINE_ROW(0x20), SINE_ROW(0x28), SINE_ROW(0x30), SINE_ROW(0x38),
+  SINE_ROW(0x40), SINE_ROW(0x48), SINE_ROW(0x50), SINE_ROW(0x58),
+  SINE_ROW(0x60), SINE_ROW(0x68), SINE_ROW(0x70), SINE_ROW(0x78)
 };
-
-// ===================================================================================
-// I2C Master Implementation (Write only)
-// ===================================================================================
-
-// I2C macros
-#define I2C_SDA_HIGH()  DDRB &= ~(1<<I2C_SDA) // release SDA   -> pulled HIGH by resistor
-#define I2C_SDA_LOW()   DDRB |=  (1<<I2C_SDA) // SDA as output -> pulled LOW  by MCU
-#define I2C_SCL_HIGH()  DDRB &= ~(1<<I2C_SCL) // release SCL   -> pulled HIGH by resistor
-#define I2C_SCL_LOW()   DDRB |=  (1<<I2C_SCL) // SCL as output -> pulled LOW  by MCU
-
-// I2C transmit one data byte to the slave, ignore ACK bit, no clock stretching allowed
-void I2C_write(uint8_t data) {
-  for(uint8_t i = 8; i; i--) {                // transmit 8 bits, MSB first
-    I2C_SDA_LOW();                            // SDA LOW for now (saves some flash this way)
-    if (data & 0x80) I2C_SDA_HIGH();          // SDA HIGH if bit is 1
-    I2C_SCL_HIGH();                           // clock HIGH -> slave reads the bit
-    data<<=1;                                 // shift left data byte, acts also as a delay
-    I2C_SCL_LOW();                            // clock LOW again
-  }
-  I2C_SDA_HIGH();                             // release SDA for ACK bit of slave
-  I2C_SCL_HIGH();                             // 9th clock pulse is for the ACK bit
-  asm("nop");                                 // ACK bit is ignored, just a delay
-  I2C_SCL_LOW();                              // clock LOW again
-}
-
-// I2C start transmission
-void I2C_start(uint8_t addr) {
-  I2C_SDA_LOW();                              // start condition: SDA goes LOW first
-  I2C_SCL_LOW();                              // start condition: SCL goes LOW second
-  I2C_write(addr);                            // send slave address
-}
-
-// I2C stop transmission
-void I2C_stop(void) {
-  I2C_SDA_LOW();                              // prepare SDA for LOW to HIGH transition
-  I2C_SCL_HIGH();                             // stop condition: SCL goes HIGH first
-  I2C_SDA_HIGH();                             // stop condition: SDA goes HIGH second
-}
+#endif
 
 // ===================================================================================
 // OLED Implementation
@@ -153,54 +154,130 @@ void I2C_stop(void) {
 // Global variables
 uint8_t OLED_xpos;                            // x position on OLED
 
-// OLED definitions
-#define OLED_ADDR       0x78                  // OLED write address
-#define OLED_CMD_MODE   0x00                  // set command mode
-#define OLED_DAT_MODE   0x40                  // set data mode
-#define OLED_INIT_LEN   12                    // 12: no screen flip, 14: screen flip
-
-// OLED init settings
-const uint8_t OLED_INIT_CMD[] PROGMEM = {
-  0xA8, 0x1F,         // set multiplex (HEIGHT-1): 0x1F for 128x32, 0x3F for 128x64 
-  0x22, 0x00, 0x03,   // set min and max page
-  0x20, 0x01,         // set vertical memory addressing mode
-  0xDA, 0x02,         // set COM pins hardware configuration to sequential
-  0x8D, 0x14,         // enable charge pump
-  0xAF,               // switch on OLED
-  0xA1, 0xC8          // flip the screen
+#if defined(HW_SCROLL)
+// The horizontal scroll of the SSD1306 moves the RAM content of the pages in its
+// window by one column every few OLED frames. Column 0 wraps around to column
+// 127. The RAM must not be written while it is active, so it is switched on for
+// a single step only: activated, stopped again after 1.5 step times, and then
+// the MCU draws. With the default oscillator and 32 rows the OLED runs at about
+// 210 frames per second, a step of 5 frames takes about 24 ms.
+#define SCROLL_MS       36                    // one and a half step times
+#define SCROLL_GAP      2                     // max unchanged columns to send along
+#define WAVE_STEPS      4                     // steps per point the wave moves against the text
+
+uint8_t sine_old;                             // sine pointer of the last step
+uint8_t scroll_all = 1;                       // first step: draw all columns
+
+// OLED scroll engine: one step to the left over all pages
+const uint8_t OLED_SCROLL_CMD[] PROGMEM = {
+  0x2E,                                       // deactivate scroll (setup only while stopped)
+  0x27, 0x00,                                 // left horizontal scroll, dummy byte
+  0x00, 0x00, 0x03,                           // start page, 5 frames per step, end page
+  0x00, 0xFF,                                 // dummy bytes
+  0x2F                                        // activate scroll
+};
+
+// OLED scroll engine: stop, the RAM may be written again
+const uint8_t OLED_STOP_CMD[] PROGMEM = {
+  0x2E                                        // deactivate scroll
 };
 
-// OLED init function
-void OLED_init(void) {
-  I2C_start(OLED_ADDR);                       // start transmission to OLED
-  I2C_write(OLED_CMD_MODE);                   // set command mode and send command bytes ...
-  for (uint8_t i = 0; i < OLED_INIT_LEN; i++) I2C_write(pgm_read_byte(&OLED_INIT_CMD[i]));
-  I2C_stop();                                 // stop transmission
+// Get the sine shift value (0..23) for a column
+uint8_t SINE_get(uint8_t p) {
+#if defined(SINE_TABLE)
+  return pgm_read_byte(&SINE_SHIFT[p & 0x7F]); // read shift value from table
+#else
+  uint8_t pt = p & 0x1F;                      // get quarter part of pointer
+  if(p & 0x20) pt = 0x1F - pt;                // mirror on the y-axis, if necessary
+  uint8_t sh = pgm_read_byte(&SINE24[pt>>1]); // read sine value
+  (pt & 1) ? (sh &= 0x0F) : (sh >>= 4);       // get correct nibble
+  if(p & 0x40) sh = 0x17 - sh;                // mirror on the x-axis, if necessary
+  return sh;
+#endif
 }
 
-// OLED set the cursor
-void OLED_cursor(uint8_t xpos, uint8_t ypos) {
-  OLED_xpos = xpos;                           // set x-position variable
-  I2C_start(OLED_ADDR);                       // start transmission to OLED
-  I2C_write(OLED_CMD_MODE);                   // set command mode
-  I2C_write(xpos & 0x0F);                     // set low nibble of start column
-  I2C_write(0x10 | (xpos >> 4));              // set high nibble of start column
-  I2C_write(0xB0 | (ypos & 0x07));            // set start page
-  I2C_stop();                                 // stop transmission
+// Get the font offset of the character at p in the message
+uint16_t SCROLL_glyph(uint8_t p) {
+#if defined(OLED_FONT_PROP)
+  return OLED_glyph(pgm_read_byte(&Message[p])); // first column and width of glyph
+#else
+  uint16_t offset = OLED_GLYPH(pgm_read_byte(&Message[p])); // number of glyph in font
+  return offset + (offset << 2);              // -> offset = glyph * 5
+#endif
+}
+
+// OLED scroll engine: move the picture one column to the left, then redraw the
+// wave in a second pass. Column x now holds the line of column x+1 at the height
+// of the last step, so it is only sent if it is not blank and the sine value at
+// x differs from the old one at x+1. Column 127 got column 0 and is always sent.
+// msg_ptr and shift point to the column at the left edge.
+void OLED_scroll(void) {
+  if(!scroll_all) {                           // picture on the OLED is known?
+    OLED_commands(OLED_SCROLL_CMD, sizeof(OLED_SCROLL_CMD)); // let the OLED move it ...
+    _delay_ms(SCROLL_MS);                     // ... by one column
+  }
+  OLED_commands(OLED_STOP_CMD, sizeof(OLED_STOP_CMD)); // stop before writing the RAM
+  uint8_t  gap    = 0;                        // columns the run may send along (0: no run)
+  uint8_t  p      = msg_ptr;                  // start character in message
+  uint8_t  col    = shift;                    // start column within character
+  uint16_t offset = SCROLL_glyph(p);          // font offset of the character
+  for(uint8_t x=0; x<128; x++) {
+    uint32_t ln = 0;                          // spacing column between characters
+    if(col) ln = pgm_read_byte(&OLED_FONT[offset + col - 1]); // read line of character
+    if(++col > CHAR_COLS) {                   // next column within character
+      col = 0;                                // start of next character
+      if(++p > sizeof(Message) - 2) p = 0;    // increase and limit pointer
+      offset = SCROLL_glyph(p);
+    }
+    uint8_t sh = SINE_get(sine_ptr + x);      // height of the line now
+    if(scroll_all || (x == 127) || (ln && (sh != SINE_get(sine_old + x + 1)))) {
+      if(!gap) {                              // no run yet?
+        OLED_START({scroll_all = 1; return;}); // no OLED: draw all columns next time
+        OLED_command(0x21);                   // set min and max column ...
+        OLED_command(x);                      // ... from this column
+        OLED_command(127);                    // ... to the right edge
+        I2C_write(OLED_DAT_MODE);             // set data mode
+      }
+      gap = SCROLL_GAP + 1;                   // unchanged columns it may still send along
+    }
+    else if(!gap) continue;                   // unchanged and no run: skip
+    else if(!--gap) {I2C_stop(); continue;}   // gap too long: end the run
+    ln <<= sh;                                // shift line according to sine value
+    for(uint8_t i=4; i; i--) {                // write the shifted line on the OLED ...
+      I2C_write(ln);
+      ln >>= 8;
+    }
+  }
+  I2C_stop();                                 // column 127 always ends in a run
+  scroll_all = 0;                             // only the changes from now on
+  sine_old = sine_ptr;                        // heights of this step
 }
 
+#else
 // OLED plot a character
 void OLED_plotChar(char c) {
-  uint16_t offset = c - 32;                   // calculate position of character in font array
-  offset += offset << 2;                      // -> offset = (c - 32) * 5
+#if defined(OLED_FONT_PROP)
+  uint16_t offset = OLED_glyph(c);            // first column and width of glyph
+#else
+  uint16_t offset = OLED_GLYPH(c);            // number of glyph in font
+  offset += offset << 2;                      // -> offset = glyph * 5
+#endif
 
-  for(uint8_t i=0; i<6; i++) {                // character consists of 5 lines + 1 space line
+  for(uint8_t i=0; i<=CHAR_COLS; i++) {       // character consists of 1 space line + 5 lines
     if(OLED_xpos > 127) return;               // stop if end of OLED
     if(i) {                                   // character line?
       if(!OLED_xpos && (shift > i)) {
         offset++;
         continue;
       }
+#if defined(SINE_TABLE)
+      uint8_t  sh = pgm_read_byte(&SINE_SHIFT[sine_ptr & 0x7F]); // read shift value from table
+      uint16_t ln = pgm_read_byte(&OLED_FONT[offset++]) << (sh & 7); // shift line within two pages
+      for(uint8_t i=0; i<4; i++) {            // write the shifted line on the OLED ...
+        if(i < (sh >> 3)) I2C_write(0x00);    // pages above the line are empty
+        else {I2C_write(ln); ln >>= 8;}       // then the two pages of the line
+      }
+#else
       uint32_t ch = pgm_read_byte(&OLED_FONT[offset++]); // read line of character
       uint8_t  pt = sine_ptr & 0x1F;          // get quarter part of pointer
       if(sine_ptr & 0x20) pt = 0x1F - pt;     // mirror on the y-axis, if necessary
@@ -212,6 +289,7 @@ void OLED_plotChar(char c) {
         I2C_write(ch);
         ch >>= 8;
       }
+#endif
     } else {                                  // spacing?
       if(!OLED_xpos && shift) continue;       // not on OLED? -> next line
       for(uint8_t i=4; i; i--) I2C_write(0x00);  // print spacing between characters
@@ -219,6 +297,7 @@ void OLED_plotChar(char c) {
     OLED_xpos++; sine_ptr++;                  // increase x position and sine table pointer
   }
 }
+#endif
 
 // ===================================================================================
 // Main Function
@@ -227,22 +306,55 @@ void OLED_plotChar(char c) {
 int main(void) {
   // Setup
   OLED_init();                                // initialize the OLED
+  PERF_init();                                // initialize instrumentation
+  FRAME_init();                               // initialize frame scheduler
 
+#if defined(HW_SCROLL)
+  // Loop
+  uint8_t steps = 0;                          // steps since the wave moved
+  while(1) {                                  // loop until forever
+    FRAME_wait();                             // sleep until the next frame is due
+#if defined(OLED_FONT_PROP)
+    OLED_glyph(pgm_read_byte(&Message[msg_ptr])); // width of the first character
+#endif
+    if(++shift > CHAR_COLS) {                 // shift within characters
+      shift = 0;                              // reset shift value
+      if(++msg_ptr > sizeof(Message) - 2) msg_ptr = 0; // shift one character further
+    }
+    OLED_scroll();                            // scroll and redraw the changed columns
+    PERF_frame();                             // frame done (instrumentation)
+    OLED_ready();                             // display on after the first frame
+    if(++steps < WAVE_STEPS) sine_ptr++;      // wave travels with the text ...
+    else steps = 0;                           // ... but stays behind every few steps
+  }
+#else
   // Loop
   while(1) {                                  // loop until forever                         
+    FRAME_wait();                             // sleep until the next frame is due
     OLED_cursor(0, 0);                        // set cursor position
-    if(++shift > 5) {                         // shift within characters
+    OLED_xpos = 0;                            // start at the left edge
+#if defined(OLED_FONT_PROP)
+    OLED_glyph(pgm_read_byte(&Message[msg_ptr])); // width of the first character
+#endif
+    if(++shift > CHAR_COLS) {                 // shift within characters
       shift = 0;                              // reset shift value
       if(++msg_ptr > sizeof(Message) - 2) msg_ptr = 0; // shift one character further
     }
     uint8_t p = msg_ptr;                      // set start character in message
-    I2C_start(OLED_ADDR);                     // start transmission to OLED
+    OLED_START(continue);                     // start transmission to OLED
     I2C_write(OLED_DAT_MODE);                 // set data mode
+#if defined(OLED_FONT_PROP)
+    while(OLED_xpos < 128) {                  // print characters up to the right edge
+#else
     for(uint8_t i=22; i; i--) {               // print 22 characters
+#endif
       OLED_plotChar(pgm_read_byte(&Message[p])); // read and print one character
       if(++p > sizeof(Message) - 2) p = 0;    // increase and limit pointer
     }
     I2C_stop();                               // stop transmission
+    PERF_frame();                             // frame done (instrumentation)
+    OLED_ready();                             // display on after the first frame
     sine_ptr -= 2;                            // shift sine wave to the right
   }
+#endif
 }
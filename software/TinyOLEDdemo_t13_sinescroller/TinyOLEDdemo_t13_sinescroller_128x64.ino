@@ -0,0 +1,220 @@
+// ===================================================================================
+// Project:   TinyOLED Demo - Sine Wave Scroller (128x64)
+// Version:   v1.0
+// Year:      2021
+// Author:    Stefan Wagner
+// Github:    https://github.com/wagiminator
+// EasyEDA:   https://easyeda.com/wagiminator
+// License:   http://creativecommons.org/licenses/by-sa/3.0/
+// ===================================================================================
+//
+// Description:
+// ------------
+// Retro-style sine wave animated text scroller for 128x64 OLEDs. The wave uses
+// the full height of the screen (amplitude 55 pixels). A column of the text
+// only covers two of the eight pages, so only the pages that hold its pixels
+// now or held them in the last frame are sent through a page window.
+//
+// References:
+// -----------
+// Sine look up table generator calculator:
+// https://www.daycounter.com/Calculators/Sine-Generator-Calculator.phtml
+//
+// OLED font was adapted from Neven Boyanov and Stephen Denne
+// https://github.com/datacute/Tiny4kOLED
+//
+// Wiring:
+// -------
+//                         +-\/-+
+//      --- RST ADC0 PB5  1|°   |8  Vcc
+//      ------- ADC3 PB3  2|    |7  PB2 ADC1 -------- OLED SCL
+//      ------- ADC2 PB4  3|    |6  PB1 AIN1 OC0B ---
+//                   GND  4|    |5  PB0 AIN0 OC0A --- OLED SDA
+//                         +----+
+//
+// Compilation Settings:
+// ---------------------
+// Controller:  ATtiny13A
+// Core:        MicroCore (https://github.com/MCUdude/MicroCore)
+// Clockspeed:  9.6 MHz internal
+// BOD:         BOD disabled
+// Timing:      Micros disabled
+//
+// Leave the rest on default settings. Don't forget to "Burn bootloader"!
+// No Arduino core functions are used. The I2C and OLED driver is the tinyOLED
+// library (software/tinyOLED), copy it into your Arduino libraries folder.
+// Use the makefile if you want to compile without Arduino IDE:
+// make SKETCH=TinyOLEDdemo_t13_sinescroller_128x64.ino
+//
+// Fuse settings: -U lfuse:w:0x3a:m -U hfuse:w:0xff:m
+
+
+// ===================================================================================
+// Libraries and Definitions
+// ===================================================================================
+
+// OLED settings
+#if !defined(SCREEN_128x64)
+#define SCREEN_128x64                         // this demo needs the full height
+#endif
+//#define OLED_FLIP                           // uncomment to flip the screen
+//#define OLED_FASTBOOT                       // short power-up wait, display on after the first frame
+#define OLED_MODE       OLED_VERTICAL         // memory addressing mode of the init sequence
+#define OLED_PRINT                            // 5x8 font
+
+// Pin definitions
+#define I2C_SDA         PB0                   // serial data pin
+#define I2C_SCL         PB2                   // serial clock pin
+//#define I2C_SDA2        PB1                   // data pin of a second OLED (same picture)
+
+// I2C_write implementation: uncomment for the hand-scheduled assembly version
+//#define I2C_ASM                             // unrolled, fixed cycle counts, ~80 bytes more flash
+
+// I2C error handling: uncomment to check the ACK of the OLED address
+//#define I2C_ACKCHECK                        // skip frames and recover the bus if it is missing
+
+// Instrumentation: uncomment to toggle a spare pin after every frame (scope timing)
+//#define PERF_PIN        PB1                   // timing pin (PB1 or PB3)
+
+// Instrumentation: uncomment to count I2C bytes, transactions and frames per second
+//#define PERF_COUNT
+
+// Frame scheduler: uncomment to sleep between the frames (battery operation)
+//#define FRAME_FPS       30                    // frame rate, rounded to 31, 16, 8 ... fps
+
+// Font: uncomment to use the font subset generated by "make font" (oled_font.h)
+//#define OLED_FONT_HEADER                        // e.g. only the glyphs of the message
+
+// Libraries
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <tinyOLED.h>                         // I2C and OLED driver (software/tinyOLED)
+#if defined(OLED_FONT_PACKED)
+#error "Packed font is not supported by OLED_plotColumn, use FONTFLAGS = -s"
+#endif
+
+// Message to scroll on OLED
+const char Message[] PROGMEM =
+  "                     ATTINY13 LOVES OLED - AND SINE WAVES, TOO! "
+  "FOR MORE INFORMATION VISIT GITHUB.COM/WAGIMINATOR.   "
+  "8-BIT POWER RULEZ!";
+
+// Global variables
+uint8_t sine_ptr;                             // sine wave table pointer
+uint8_t msg_ptr;                              // message pointer
+uint8_t shift;                                // character shift
+uint8_t scroll_all = 1;                       // first frame: send all pages of all columns
+
+// ===================================================================================
+// Sine Wave Look Up Table
+// ===================================================================================
+
+// Sine wave table (quarter wave, amplitude 55, 32 points)
+const uint8_t SINE56[] PROGMEM = {
+  27, 25, 24, 23, 21, 20, 19, 18, 16, 15, 14, 13, 12, 11, 10,  9,
+   8,  7,  6,  5,  4,  4,  3,  2,  2,  1,  1,  1,  0,  0,  0,  0
+};
+
+// Get the sine shift value (0..55) for a pointer
+uint8_t SINE_get(uint8_t p) {
+  uint8_t pt = p & 0x1F;                      // get quarter part of pointer
+  if(p & 0x20) pt = 0x1F - pt;                // mirror on the y-axis, if necessary
+  uint8_t sh = pgm_read_byte(&SINE56[pt]);    // read sine value
+  if(p & 0x40) sh = 0x37 - sh;                // mirror on the x-axis, if necessary
+  return sh;
+}
+
+// ===================================================================================
+// OLED Implementation
+// ===================================================================================
+
+// OLED send the pages first..last of a column with the line shifted by sh. The
+// shift is computed once, the line covers only the pages sh/8 and sh/8 + 1.
+void OLED_plotColumn(uint8_t ln, uint8_t sh, uint8_t first, uint8_t last) {
+  uint16_t w = ln << (sh & 7);                // shift line within two pages
+  uint8_t  pg = sh >> 3;                      // upper page of the line
+  for(uint8_t i=first; i<=last; i++) {        // write the pages of the window ...
+    if(i == pg)          I2C_write(w);        // upper part of the line
+    else if(i == pg + 1) I2C_write(w >> 8);   // lower part of the line
+    else                 I2C_write(0x00);     // pages without the line are empty
+  }
+}
+
+// OLED print one frame of the scroller. The text moves by one column and the
+// wave by two points per frame, so column x held the line of column x-1 at the
+// sine value of point x+2 in the last frame. Only the pages of both lines are
+// sent, blank columns that were blank before are skipped. A run of columns that
+// fits into the page window of its first column is sent in one transaction.
+void OLED_printS(void) {
+  uint8_t first = 0xFF, last = 0;             // page window of the run (none yet)
+  uint8_t prev  = 0xFF;                       // line before the left edge is unknown
+  uint8_t p     = msg_ptr;                    // start character in message
+  uint8_t col   = shift;                      // start column within character
+  for(uint8_t x=0; x<128; x++) {
+    uint8_t ln = 0;                           // spacing column between characters
+    if(col) {                                 // character line?
+      uint16_t offset = OLED_GLYPH(pgm_read_byte(&Message[p])); // number of glyph in font
+      offset += offset << 2;                  // -> offset = glyph * 5
+      ln = pgm_read_byte(&OLED_FONT[offset + col - 1]); // read line of character
+    }
+    if(++col > 5) {                           // next column within character
+      col = 0;                                // start of next character
+      if(++p > sizeof(Message) - 2) p = 0;    // increase and limit pointer
+    }
+    uint8_t pt = sine_ptr + x;                // sine pointer of column
+    uint8_t sh = SINE_get(pt);                // height of the line now ...
+    uint8_t lo = 7, hi = 0;                   // pages to send (none yet)
+    if(ln)   {lo = sh >> 3; hi = (sh + 7) >> 3;}
+    if(prev) {                                // ... and in the last frame
+      uint8_t sp = SINE_get(pt + 2);
+      if((sp >> 3) < lo)       lo = sp >> 3;
+      if(((sp + 7) >> 3) > hi) hi = (sp + 7) >> 3;
+    }
+    prev = ln;
+    if(scroll_all) {lo = 0; hi = 7;}          // OLED content unknown: all pages
+    else if(lo > hi) {                        // blank column stays blank:
+      if(first != 0xFF) I2C_stop();           // end the run, the next column
+      first = 0xFF;                           // starts a new transaction
+      continue;
+    }
+    if((lo < first) || (hi > last)) {         // column does not fit into the window?
+      if(first != 0xFF) I2C_stop();           // end the previous run
+      OLED_START({scroll_all = 1; return;});  // no OLED: send everything next time
+      OLED_command(0x21);                     // set min and max column ...
+      OLED_command(x);                        // ... from this column
+      OLED_command(127);                      // ... to the right edge
+      OLED_command(0x22);                     // set min and max page ...
+      OLED_command(lo);                       // ... from the upper page
+      OLED_command(hi);                       // ... to the lower page
+      I2C_write(OLED_DAT_MODE);               // set data mode
+      first = lo; last = hi;
+    }
+    OLED_plotColumn(ln, sh, first, last);     // send the pages of the column
+  }
+  if(first != 0xFF) I2C_stop();               // stop transmission
+  scroll_all = 0;                             // only the changed pages from now on
+}
+
+// ===================================================================================
+// Main Function
+// ===================================================================================
+
+int main(void) {
+  // Setup
+  OLED_init();                                // initialize the OLED
+  PERF_init();                                // initialize instrumentation
+  FRAME_init();                               // initialize frame scheduler
+
+  // Loop
+  while(1) {                                  // loop until forever
+    FRAME_wait();                             // sleep until the next frame is due
+    if(++shift > 5) {                         // shift within characters
+      shift = 0;                              // reset shift value
+      if(++msg_ptr > sizeof(Message) - 2) msg_ptr = 0; // shift one character further
+    }
+    OLED_printS();                            // print the changed pages of the frame
+    PERF_frame();                             // frame done (instrumentation)
+    OLED_ready();                             // display on after the first frame
+    sine_ptr -= 2;                            // shift sine wave to the right
+  }
+}
@@ -38,8 +38,9 @@
 // Timing:      Micros disabled
 //
 // Leave the rest on default settings. Don't forget to "Burn bootloader"!
-// No Arduino core functions or libraries are used. Use the makefile if 
-// you want to compile without Arduino IDE.
+// No Arduino core functions are used. The I2C and OLED driver is the tinyOLED
+// library (software/tinyOLED), copy it into your Arduino libraries folder.
+// Use the makefile if you want to compile without Arduino IDE.
 //
 // Fuse settings: -U lfuse:w:0x3a:m -U hfuse:w:0xff:m
 
@@ -48,13 +49,45 @@
 // Libraries and Definitions
 // ===================================================================================
 
-// Libraries
-#include <avr/io.h>
-#include <avr/pgmspace.h>
+// OLED settings
+//#define OLED_FLIP                           // uncomment to flip the screen
+//#define OLED_FASTBOOT                       // short power-up wait, display on after the first frame
+#define OLED_MODE       OLED_VERTICAL         // memory addressing mode of the init sequence
+#define OLED_PRINT                            // 5x8 font
 
 // Pin definitions
 #define I2C_SDA         PB0                   // serial data pin
 #define I2C_SCL         PB2                   // serial clock pin
+//#define I2C_SDA2        PB1                   // data pin of a second OLED (same picture)
+
+// I2C_write implementation: uncomment for the hand-scheduled assembly version
+//#define I2C_ASM                             // unrolled, fixed cycle counts, ~80 bytes more flash
+
+// I2C error handling: uncomment to check the ACK of the OLED address
+//#define I2C_ACKCHECK                        // skip frames and recover the bus if it is missing
+
+// Instrumentation: uncomment to toggle a spare pin after every frame (scope timing)
+//#define PERF_PIN        PB1                   // timing pin (PB1 or PB3)
+
+// Instrumentation: uncomment to count I2C bytes, transactions and frames per second
+//#define PERF_COUNT
+
+// Frame scheduler: uncomment to sleep between the frames (battery operation)
+//#define FRAME_FPS       30                    // frame rate, rounded to 31, 16, 8 ... fps
+
+// Sine wave renderer: uncomment to use a precomputed full wave shift table
+//#define SINE_TABLE                          // faster, ~110 bytes more flash
+
+// Frame differencing: uncomment to send only the columns that moved since the last frame
+//#define SINE_DIFF                           // column window per run, no frame buffer needed
+
+// Libraries
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <tinyOLED.h>                         // I2C and OLED driver (software/tinyOLED)
+#if OLED_PAGES != 4
+#error "This demo draws 4 pages (128x32), use TinyOLEDdemo_t13_sinewave_128x64.ino for 128x64"
+#endif
 
 // Message to print on OLED (21 characters)
 const char Message[] PROGMEM = "ATTINY13 LOVES OLED !";
@@ -72,104 +105,27 @@ const uint8_t SINE24[] PROGMEM = {
   0x33, 0x32, 0x22, 0x11, 0x11, 0x00, 0x00, 0x00
 };
 
-// ===================================================================================
-// OLED Font
-// ===================================================================================
+#if defined(SINE_TABLE)
+// Compile-time generator for the full wave shift table (mirrored from SINE24)
+#define SINE_PT(p)      (((p) & 0x20) ? 0x1F - ((p) & 0x1F) : ((p) & 0x1F))
+#define SINE_NIB(pt)    (((pt) & 1) ? (SINE24[(pt)>>1] & 0x0F) : (SINE24[(pt)>>1] >> 4))
+#define SINE_SH(p)      (((p) & 0x40) ? 0x17 - SINE_NIB(SINE_PT(p)) : SINE_NIB(SINE_PT(p)))
+#define SINE_ROW(p)     SINE_SH(p+0), SINE_SH(p+1), SINE_SH(p+2), SINE_SH(p+3), \
+                        SINE_SH(p+4), SINE_SH(p+5), SINE_SH(p+6), SINE_SH(p+7)
 
-// Standard ASCII 5x8 font (adapted from Neven Boyanov and Stephen Denne)
-const uint8_t OLED_FONT[] PROGMEM = {
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2F, 0x00, 0x00, 0x00, 0x07, 0x00, 0x07, 0x00,
-  0x14, 0x7F, 0x14, 0x7F, 0x14, 0x24, 0x2A, 0x7F, 0x2A, 0x12, 0x23, 0x13, 0x08, 0x64, 0x62,
-  0x36, 0x49, 0x55, 0x22, 0x50, 0x00, 0x05, 0x03, 0x00, 0x00, 0x00, 0x1C, 0x22, 0x41, 0x00,
-  0x00, 0x41, 0x22, 0x1C, 0x00, 0x14, 0x08, 0x3E, 0x08, 0x14, 0x08, 0x08, 0x3E, 0x08, 0x08,
-  0x00, 0x00, 0xA0, 0x60, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x60, 0x60, 0x00, 0x00,
-  0x20, 0x10, 0x08, 0x04, 0x02, 0x3E, 0x51, 0x49, 0x45, 0x3E, 0x00, 0x42, 0x7F, 0x40, 0x00,
-  0x42, 0x61, 0x51, 0x49, 0x46, 0x21, 0x41, 0x45, 0x4B, 0x31, 0x18, 0x14, 0x12, 0x7F, 0x10,
-  0x27, 0x45, 0x45, 0x45, 0x39, 0x3C, 0x4A, 0x49, 0x49, 0x30, 0x01, 0x71, 0x09, 0x05, 0x03,
-  0x36, 0x49, 0x49, 0x49, 0x36, 0x06, 0x49, 0x49, 0x29, 0x1E, 0x00, 0x36, 0x36, 0x00, 0x00,
-  0x00, 0x56, 0x36, 0x00, 0x00, 0x08, 0x14, 0x22, 0x41, 0x00, 0x14, 0x14, 0x14, 0x14, 0x14,
-  0x00, 0x41, 0x22, 0x14, 0x08, 0x02, 0x01, 0x51, 0x09, 0x06, 0x32, 0x49, 0x59, 0x51, 0x3E,
-  0x7C, 0x12, 0x11, 0x12, 0x7C, 0x7F, 0x49, 0x49, 0x49, 0x36, 0x3E, 0x41, 0x41, 0x41, 0x22,
-  0x7F, 0x41, 0x41, 0x22, 0x1C, 0x7F, 0x49, 0x49, 0x49, 0x41, 0x7F, 0x09, 0x09, 0x09, 0x01,
-  0x3E, 0x41, 0x49, 0x49, 0x7A, 0x7F, 0x08, 0x08, 0x08, 0x7F, 0x00, 0x41, 0x7F, 0x41, 0x00,
-  0x20, 0x40, 0x41, 0x3F, 0x01, 0x7F, 0x08, 0x14, 0x22, 0x41, 0x7F, 0x40, 0x40, 0x40, 0x40,
-  0x7F, 0x02, 0x0C, 0x02, 0x7F, 0x7F, 0x04, 0x08, 0x10, 0x7F, 0x3E, 0x41, 0x41, 0x41, 0x3E,
-  0x7F, 0x09, 0x09, 0x09, 0x06, 0x3E, 0x41, 0x51, 0x21, 0x5E, 0x7F, 0x09, 0x19, 0x29, 0x46,
-  0x46, 0x49, 0x49, 0x49, 0x31, 0x01, 0x01, 0x7F, 0x01, 0x01, 0x3F, 0x40, 0x40, 0x40, 0x3F,
-  0x1F, 0x20, 0x40, 0x20, 0x1F, 0x3F, 0x40, 0x38, 0x40, 0x3F, 0x63, 0x14, 0x08, 0x14, 0x63,
-  0x07, 0x08, 0x70, 0x08, 0x07, 0x61, 0x51, 0x49, 0x45, 0x43, 0x00, 0x7F, 0x41, 0x41, 0x00,
-  0x02, 0x04, 0x08, 0x10, 0x20, 0x00, 0x41, 0x41, 0x7F, 0x00, 0x04, 0x02, 0x01, 0x02, 0x04,
-  0x40, 0x40, 0x40, 0x40, 0x40
+// Sine wave shift table (full wave, 128 points, shift value 0..23 per point)
+const uint8_t SINE_SHIFT[] PROGMEM = {
+  SINE_ROW(0x00), SINE_ROW(0x08), SINE_ROW(0x10), SINE_ROW(0x18),
+  SINE_ROW(0x20), SINE_ROW(0x28), SINE_ROW(0x30), SINE_ROW(0x38),
+  SINE_ROW(0x40), SINE_ROW(0x48), SINE_ROW(0x50), SINE_ROW(0x58),
+  SINE_ROW(0x60), SINE_ROW(0x68), SINE_ROW(0x70), SINE_ROW(0x78)
 };
-
-// ===================================================================================
-// I2C Master Implementation (Write only)
-// ===================================================================================
-
-// I2C macros
-#define I2C_SDA_HIGH()  DDRB &= ~(1<<I2C_SDA) // release SDA   -> pulled HIGH by resistor
-#define I2C_SDA_LOW()   DDRB |=  (1<<I2C_SDA) // SDA as output -> pulled LOW  by MCU
-#define I2C_SCL_HIGH()  DDRB &= ~(1<<I2C_SCL) // release SCL   -> pulled HIGH by resistor
-#define I2C_SCL_LOW()   DDRB |=  (1<<I2C_SCL) // SCL as output -> pulled LOW  by MCU
-
-// I2C transmit one data byte to the slave, ignore ACK bit, no clock stretching allowed
-void I2C_write(uint8_t data) {
-  for(uint8_t i = 8; i; i--) {                // transmit 8 bits, MSB first
-    I2C_SDA_LOW();                            // SDA LOW for now (saves some flash this way)
-    if (data & 0x80) I2C_SDA_HIGH();          // SDA HIGH if bit is 1
-    I2C_SCL_HIGH();                           // clock HIGH -> slave reads the bit
-    data<<=1;                                 // shift left data byte, acts also as a delay
-    I2C_SCL_LOW();                            // clock LOW again
-  }
-  I2C_SDA_HIGH();                             // release SDA for ACK bit of slave
-  I2C_SCL_HIGH();                             // 9th clock pulse is for the ACK bit
-  asm("nop");                                 // ACK bit is ignored, just a delay
-  I2C_SCL_LOW();                              // clock LOW again
-}
-
-// I2C start transmission
-void I2C_start(uint8_t addr) {
-  I2C_SDA_LOW();                              // start condition: SDA goes LOW first
-  I2C_SCL_LOW();                              // start condition: SCL goes LOW second
-  I2C_write(addr);                            // send slave address
-}
-
-// I2C stop transmission
-void I2C_stop(void) {
-  I2C_SDA_LOW();                              // prepare SDA for LOW to HIGH transition
-  I2C_SCL_HIGH();                             // stop condition: SCL goes HIGH first
-  I2C_SDA_HIGH();                             // stop condition: SDA goes HIGH second
-}
+#endif
 
 // ===================================================================================
 // OLED Implementation
 // ===================================================================================
 
-// OLED definitions
-#define OLED_ADDR       0x78                  // OLED write address
-#define OLED_CMD_MODE   0x00                  // set command mode
-#define OLED_DAT_MODE   0x40                  // set data mode
-#define OLED_INIT_LEN   12                    // 12: no screen flip, 14: screen flip
-
-// OLED init settings
-const uint8_t OLED_INIT_CMD[] PROGMEM = {
-  0xA8, 0x1F,         // set multiplex (HEIGHT-1): 0x1F for 128x32, 0x3F for 128x64 
-  0x22, 0x00, 0x03,   // set min and max page
-  0x20, 0x01,         // set vertical memory addressing mode
-  0xDA, 0x02,         // set COM pins hardware configuration to sequential
-  0x8D, 0x14,         // enable charge pump
-  0xAF,               // switch on OLED
-  0xA1, 0xC8          // flip the screen
-};
-
-// OLED init function
-void OLED_init(void) {
-  I2C_start(OLED_ADDR);                       // start transmission to OLED
-  I2C_write(OLED_CMD_MODE);                   // set command mode and send command bytes ...
-  for (uint8_t i = 0; i < OLED_INIT_LEN; i++) I2C_write(pgm_read_byte(&OLED_INIT_CMD[i]));
-  I2C_stop();                                 // stop transmission
-}
-
 // OLED plot a character
 void OLED_plotChar(char c) {
   uint16_t offset = c - 32;                   // calculate position of character in font array
@@ -177,6 +133,14 @@ void OLED_plotChar(char c) {
   for(uint8_t i=4; i; i--) I2C_write(0x00);   // print spacing between characters
   sine_ptr++;                                 // increase sine table pointer
   for(uint8_t i=5; i; i--) {                  // character consists of 5 lines
+#if defined(SINE_TABLE)
+    uint8_t  sh = pgm_read_byte(&SINE_SHIFT[sine_ptr & 0x7F]); // read shift value from table
+    uint16_t ln = pgm_read_byte(&OLED_FONT[offset++]) << (sh & 7); // shift line within two pages
+    for(uint8_t i=0; i<4; i++) {              // write the shifted line on the OLED ...
+      if(i < (sh >> 3)) I2C_write(0x00);      // pages above the line are empty
+      else {I2C_write(ln); ln >>= 8;}         // then the two pages of the line
+    }
+#else
     uint32_t ch = pgm_read_byte(&OLED_FONT[offset++]); // read line of character
     uint8_t  pt = sine_ptr & 0x1F;            // get quarter part of pointer
     if(sine_ptr & 0x20) pt = 0x1F - pt;       // mirror on the y-axis, if necessary
@@ -184,17 +148,88 @@ void OLED_plotChar(char c) {
     (pt & 1) ? (sh &= 0x0F) : (sh >>= 4);     // get correct nibble
     if(sine_ptr & 0x40) sh = 0x17 - sh;       // mirror on the x-axis, if necessary
     ch <<= sh;                                // shift char according to sine table value
-    sine_ptr++;                               // increase sine table pointer
     for(uint8_t i=4; i; i--) {                // write the shifted line on the OLED ...
       I2C_write(ch);
       ch >>= 8;
     }
+#endif
+    sine_ptr++;                               // increase sine table pointer
   }
 }
 
+#if defined(SINE_DIFF)
+#define DIFF_GAP        2                     // max unchanged columns to send along
+
+uint8_t diff_all = 1;                         // first frame: draw all columns
+
+// Get the sine shift value (0..23) for a pointer
+uint8_t SINE_get(uint8_t p) {
+#if defined(SINE_TABLE)
+  return pgm_read_byte(&SINE_SHIFT[p & 0x7F]); // read shift value from table
+#else
+  uint8_t pt = p & 0x1F;                      // get quarter part of pointer
+  if(p & 0x20) pt = 0x1F - pt;                // mirror on the y-axis, if necessary
+  uint8_t sh = pgm_read_byte(&SINE24[pt>>1]); // read sine value
+  (pt & 1) ? (sh &= 0x0F) : (sh >>= 4);       // get correct nibble
+  if(p & 0x40) sh = 0x17 - sh;                // mirror on the x-axis, if necessary
+  return sh;
+#endif
+}
+
+// Get the line of the message in column x (0 for the spacing columns)
+uint8_t SINE_line(const char* p, uint8_t x) {
+  uint8_t col = x % 6;                        // column within the character
+  if(!col) return 0;                          // spacing between characters
+  uint16_t offset = OLED_GLYPH(pgm_read_byte(&p[x / 6])); // number of glyph in font
+  offset += offset << 2;                      // -> offset = glyph * 5
+  return pgm_read_byte(&OLED_FONT[offset + col - 1]); // read line of character
+}
+
+// OLED plot the line of column x at the height of the sine wave
+void OLED_plotLine(const char* p, uint8_t x) {
+  uint32_t ln = SINE_line(p, x);              // read line of column
+  ln <<= SINE_get(sine_ptr + x);              // shift line according to sine value
+  for(uint8_t i=4; i; i--) {                  // write the shifted line on the OLED ...
+    I2C_write(ln);
+    ln >>= 8;
+  }
+}
+
+// OLED print the message, but only the columns that differ from the last frame.
+// The message stays the same and the wave moves by three points per frame
+// (OLED_print advances the pointer by 126, main goes back by one), so a column
+// only changes if it is not blank and the sine value of its point is not the
+// same as the one three points further, which it had in the last frame. Each
+// run of changed columns is sent through a column window in its own
+// transaction, short gaps of unchanged columns are sent along.
+void OLED_printD(const char* p) {
+  uint8_t last = 0xFF;                        // last column sent (none yet)
+  for(uint8_t x=0; x<126; x++) {              // 21 characters of 6 columns
+    if(!SINE_line(p, x)) continue;            // blank column stays blank
+    uint8_t pt = sine_ptr + x;                // sine pointer of column
+    if(!diff_all && (SINE_get(pt) == SINE_get(pt + 3))) continue; // same height as before
+    if((last != 0xFF) && (x - last <= DIFF_GAP + 1)) {
+      while(last < x) OLED_plotLine(p, ++last); // join run: send the gap along
+      continue;
+    }
+    if(last != 0xFF) I2C_stop();              // end the previous run
+    OLED_START({diff_all = 1; return;});      // no OLED: draw all columns next time
+    OLED_command(0x21);                       // set min and max column ...
+    OLED_command(x);                          // ... from this column
+    OLED_command(127);                        // ... to the right edge
+    I2C_write(OLED_DAT_MODE);                 // set data mode
+    OLED_plotLine(p, x);                      // send the column
+    last = x;
+  }
+  if(last != 0xFF) I2C_stop();                // stop transmission
+  diff_all = 0;                               // only changes from now on
+  sine_ptr += 126;                            // advance the wave like OLED_print does
+}
+#endif
+
 // OLED print a string from program memory
 void OLED_print(const char* p) {
-  I2C_start(OLED_ADDR);                       // start transmission to OLED
+  OLED_START(return);                         // start transmission to OLED
   I2C_write(OLED_DAT_MODE);                   // set data mode
   char ch = pgm_read_byte(p);                 // read first character from program memory
   while (ch != 0) {                           // repeat until string terminator
@@ -204,25 +239,6 @@ void OLED_print(const char* p) {
   I2C_stop();                                 // stop transmission
 }
 
-// OLED set the cursor
-void OLED_cursor(uint8_t xpos, uint8_t ypos) {
-  I2C_start(OLED_ADDR);                       // start transmission to OLED
-  I2C_write(OLED_CMD_MODE);                   // set command mode
-  I2C_write(xpos & 0x0F);                     // set low nibble of start column
-  I2C_write(0x10 | (xpos >> 4));              // set high nibble of start column
-  I2C_write(0xB0 | (ypos & 0x07));            // set start page
-  I2C_stop();                                 // stop transmission
-}
-
-// OLED clear screen
-void OLED_clear(void) {
-  OLED_cursor(0, 0);                          // set cursor at upper left corner
-  I2C_start(OLED_ADDR);                       // start transmission to OLED
-  I2C_write(OLED_DAT_MODE);                   // set data mode
-  for(uint16_t i=512; i; i--) I2C_write(0x00);// clear the screen
-  I2C_stop();                                 // stop transmission
-}
-
 // ===================================================================================
 // Main Function
 // ===================================================================================
@@ -230,13 +246,22 @@ void OLED_clear(void) {
 int main(void) {
   // Setup
   OLED_init();                                // initialize the OLED
+  PERF_init();                                // initialize instrumentation
+  FRAME_init();                               // initialize frame scheduler
   OLED_clear();                               // clear screen
 
   // Loop
   while(1) {                                  // loop until forever                         
+    FRAME_wait();                             // sleep until the next frame is due
     // Animate messages
+#if defined(SINE_DIFF)
+    OLED_printD(Message);                     // print the changed columns of the message
+#else
     OLED_cursor(0, 0);                        // set cursor position
     OLED_print(Message);                      // print message
+#endif
+    PERF_frame();                             // frame done (instrumentation)
+    OLED_ready();                             // display on after the first frame
     sine_ptr--;                               // shift whole wave to the right
   }
 }
@@ -38,15 +38,18 @@
 // Timing:      Micros disabled
 //
 // Leave the rest on default settings. Don't forget to "Burn bootloader"!
-// No Arduino core functions or libraries are used. Use the makefile if 
-// you want to compile without Arduino IDE.
+// No Arduino core functions are used. The I2C and OLED driver is the tinyOLED
+// library (software/tinyOLED), copy it into your Arduino libraries folder.
+// Use the makefile if you want to compile without Arduino IDE.
 //
 // Fuse settings: -U lfuse:w:0x3a:m -U hfuse:w:0xff:m
 
 
-// Select the screen size
+// Select the screen size (or SCREEN = ... in the makefile)
+#if !defined(SCREEN_128x32) && !defined(SCREEN_128x64)
 #define SCREEN_128x32
 //#define SCREEN_128x64
+#endif
 
 
 #if defined(SCREEN_128x32) and defined(SCREEN_128x64)
@@ -60,13 +63,39 @@
 // Libraries and Definitions
 // ===================================================================================
 
-// Libraries
-#include <avr/io.h>
-#include <avr/pgmspace.h>
+// OLED settings
+//#define OLED_FLIP                           // uncomment to flip the screen
+//#define OLED_FASTBOOT                       // short power-up wait, display on after the first frame
+#define OLED_MODE       OLED_VERTICAL         // memory addressing mode of the init sequence
+#define OLED_PRINT                            // 5x8 font
 
 // Pin definitions
 #define I2C_SDA         PB0                   // serial data pin
 #define I2C_SCL         PB2                   // serial clock pin
+//#define I2C_SDA2        PB1                   // data pin of a second OLED (same picture)
+
+// I2C_write implementation: uncomment for the hand-scheduled assembly version
+//#define I2C_ASM                             // unrolled, fixed cycle counts, ~80 bytes more flash
+
+// I2C error handling: uncomment to check the ACK of the OLED address
+//#define I2C_ACKCHECK                        // skip frames and recover the bus if it is missing
+
+// Instrumentation: uncomment to toggle a spare pin after every frame (scope timing)
+//#define PERF_PIN        PB1                   // timing pin (PB1 or PB3)
+
+// Instrumentation: uncomment to count I2C bytes, transactions and frames per second
+//#define PERF_COUNT
+
+// Frame scheduler: uncomment to sleep between the frames (battery operation)
+//#define FRAME_FPS       30                    // frame rate, rounded to 31, 16, 8 ... fps
+
+// Sine wave renderer: uncomment to use a precomputed full wave shift table
+//#define SINE_TABLE                          // faster, ~110 bytes more flash
+
+// Libraries
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <tinyOLED.h>                         // I2C and OLED driver (software/tinyOLED)
 
 // Message to print on OLED (21 characters)
 const char Message[] PROGMEM = "ATTINY13 LOVES OLED !";
@@ -84,112 +113,27 @@ const uint8_t SINE24[] PROGMEM = {
   0x33, 0x32, 0x22, 0x11, 0x11, 0x00, 0x00, 0x00
 };
 
-// ===================================================================================
-// OLED Font
-// ===================================================================================
-
-// Standard ASCII 5x8 font (adapted from Neven Boyanov and Stephen Denne)
-const uint8_t OLED_FONT[] PROGMEM = {
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2F, 0x00, 0x00, 0x00, 0x07, 0x00, 0x07, 0x00,
-  0x14, 0x7F, 0x14, 0x7F, 0x14, 0x24, 0x2A, 0x7F, 0x2A, 0x12, 0x23, 0x13, 0x08, 0x64, 0x62,
-  0x36, 0x49, 0x55, 0x22, 0x50, 0x00, 0x05, 0x03, 0x00, 0x00, 0x00, 0x1C, 0x22, 0x41, 0x00,
-  0x00, 0x41, 0x22, 0x1C, 0x00, 0x14, 0x08, 0x3E, 0x08, 0x14, 0x08, 0x08, 0x3E, 0x08, 0x08,
-  0x00, 0x00, 0xA0, 0x60, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x60, 0x60, 0x00, 0x00,
-  0x20, 0x10, 0x08, 0x04, 0x02, 0x3E, 0x51, 0x49, 0x45, 0x3E, 0x00, 0x42, 0x7F, 0x40, 0x00,
-  0x42, 0x61, 0x51, 0x49, 0x46, 0x21, 0x41, 0x45, 0x4B, 0x31, 0x18, 0x14, 0x12, 0x7F, 0x10,
-  0x27, 0x45, 0x45, 0x45, 0x39, 0x3C, 0x4A, 0x49, 0x49, 0x30, 0x01, 0x71, 0x09, 0x05, 0x03,
-  0x36, 0x49, 0x49, 0x49, 0x36, 0x06, 0x49, 0x49, 0x29, 0x1E, 0x00, 0x36, 0x36, 0x00, 0x00,
-  0x00, 0x56, 0x36, 0x00, 0x00, 0x08, 0x14, 0x22, 0x41, 0x00, 0x14, 0x14, 0x14, 0x14, 0x14,
-  0x00, 0x41, 0x22, 0x14, 0x08, 0x02, 0x01, 0x51, 0x09, 0x06, 0x32, 0x49, 0x59, 0x51, 0x3E,
-  0x7C, 0x12, 0x11, 0x12, 0x7C, 0x7F, 0x49, 0x49, 0x49, 0x36, 0x3E, 0x41, 0x41, 0x41, 0x22,
-  0x7F, 0x41, 0x41, 0x22, 0x1C, 0x7F, 0x49, 0x49, 0x49, 0x41, 0x7F, 0x09, 0x09, 0x09, 0x01,
-  0x3E, 0x41, 0x49, 0x49, 0x7A, 0x7F, 0x08, 0x08, 0x08, 0x7F, 0x00, 0x41, 0x7F, 0x41, 0x00,
-  0x20, 0x40, 0x41, 0x3F, 0x01, 0x7F, 0x08, 0x14, 0x22, 0x41, 0x7F, 0x40, 0x40, 0x40, 0x40,
-  0x7F, 0x02, 0x0C, 0x02, 0x7F, 0x7F, 0x04, 0x08, 0x10, 0x7F, 0x3E, 0x41, 0x41, 0x41, 0x3E,
-  0x7F, 0x09, 0x09, 0x09, 0x06, 0x3E, 0x41, 0x51, 0x21, 0x5E, 0x7F, 0x09, 0x19, 0x29, 0x46,
-  0x46, 0x49, 0x49, 0x49, 0x31, 0x01, 0x01, 0x7F, 0x01, 0x01, 0x3F, 0x40, 0x40, 0x40, 0x3F,
-  0x1F, 0x20, 0x40, 0x20, 0x1F, 0x3F, 0x40, 0x38, 0x40, 0x3F, 0x63, 0x14, 0x08, 0x14, 0x63,
-  0x07, 0x08, 0x70, 0x08, 0x07, 0x61, 0x51, 0x49, 0x45, 0x43, 0x00, 0x7F, 0x41, 0x41, 0x00,
-  0x02, 0x04, 0x08, 0x10, 0x20, 0x00, 0x41, 0x41, 0x7F, 0x00, 0x04, 0x02, 0x01, 0x02, 0x04,
-  0x40, 0x40, 0x40, 0x40, 0x40
+#if defined(SINE_TABLE)
+// Compile-time generator for the full wave shift table (mirrored from SINE24)
+#define SINE_PT(p)      (((p) & 0x20) ? 0x1F - ((p) & 0x1F) : ((p) & 0x1F))
+#define SINE_NIB(pt)    (((pt) & 1) ? (SINE24[(pt)>>1] & 0x0F) : (SINE24[(pt)>>1] >> 4))
+#define SINE_SH(p)      (((p) & 0x40) ? 0x17 - SINE_NIB(SINE_PT(p)) : SINE_NIB(SINE_PT(p)))
+#define SINE_ROW(p)     SINE_SH(p+0), SINE_SH(p+1), SINE_SH(p+2), SINE_SH(p+3), \
+                        SINE_SH(p+4), SINE_SH(p+5), SINE_SH(p+6), SINE_SH(p+7)
+
+// Sine wave shift table (full wave, 128 points, shift value 0..23 per point)
+const uint8_t SINE_SHIFT[] PROGMEM = {
+  SINE_ROW(0x00), SINE_ROW(0x08), SINE_ROW(0x10), SINE_ROW(0x18),
+  SINE_ROW(0x20), SINE_ROW(0x28), SINE_ROW(0x30), SINE_ROW(0x38),
+  SINE_ROW(0x40), SINE_ROW(0x48), SINE_ROW(0x50), SINE_ROW(0x58),
+  SINE_ROW(0x60), SINE_ROW(0x68), SINE_ROW(0x70), SINE_ROW(0x78)
 };
-
-// ===================================================================================
-// I2C Master Implementation (Write only)
-// ===================================================================================
-
-// I2C macros
-#define I2C_SDA_HIGH()  DDRB &= ~(1<<I2C_SDA) // release SDA   -> pulled HIGH by resistor
-#define I2C_SDA_LOW()   DDRB |=  (1<<I2C_SDA) // SDA as output -> pulled LOW  by MCU
-#define I2C_SCL_HIGH()  DDRB &= ~(1<<I2C_SCL) // release SCL   -> pulled HIGH by resistor
-#define I2C_SCL_LOW()   DDRB |=  (1<<I2C_SCL) // SCL as output -> pulled LOW  by MCU
-
-// I2C transmit one data byte to the slave, ignore ACK bit, no clock stretching allowed
-void I2C_write(uint8_t data) {
-  for(uint8_t i = 8; i; i--) {                // transmit 8 bits, MSB first
-    I2C_SDA_LOW();                            // SDA LOW for now (saves some flash this way)
-    if (data & 0x80) I2C_SDA_HIGH();          // SDA HIGH if bit is 1
-    I2C_SCL_HIGH();                           // clock HIGH -> slave reads the bit
-    data<<=1;                                 // shift left data byte, acts also as a delay
-    I2C_SCL_LOW();                            // clock LOW again
-  }
-  I2C_SDA_HIGH();                             // release SDA for ACK bit of slave
-  I2C_SCL_HIGH();                             // 9th clock pulse is for the ACK bit
-  asm("nop");                                 // ACK bit is ignored, just a delay
-  I2C_SCL_LOW();                              // clock LOW again
-}
-
-// I2C start transmission
-void I2C_start(uint8_t addr) {
-  I2C_SDA_LOW();                              // start condition: SDA goes LOW first
-  I2C_SCL_LOW();                              // start condition: SCL goes LOW second
-  I2C_write(addr);                            // send slave address
-}
-
-// I2C stop transmission
-void I2C_stop(void) {
-  I2C_SDA_LOW();                              // prepare SDA for LOW to HIGH transition
-  I2C_SCL_HIGH();                             // stop condition: SCL goes HIGH first
-  I2C_SDA_HIGH();                             // stop condition: SDA goes HIGH second
-}
+#endif
 
 // ===================================================================================
 // OLED Implementation
 // ===================================================================================
 
-// OLED definitions
-#define OLED_ADDR       0x78                  // OLED write address
-#define OLED_CMD_MODE   0x00                  // set command mode
-#define OLED_DAT_MODE   0x40                  // set data mode
-#if defined(SCREEN_128x32)
-#define OLED_INIT_LEN   9                    // 9: no screen flip, 11: screen flip
-#define MULTIPLEX 0x1F
-#else
-#define OLED_INIT_LEN   7                    // 7: no screen flip, 9: screen flip
-#define MULTIPLEX 0x3F
-#endif
-
-// OLED init settings
-const uint8_t OLED_INIT_CMD[] PROGMEM = {
-  0xA8, MULTIPLEX,     // set multiplex (HEIGHT-1): 0x1F for 128x32, 0x3F for 128x64 
-//  0x22, 0x02, 0x05,   // set min and max page => done after init
-  0x20, 0x01,         // set vertical memory addressing mode
-#if defined(SCREEN_128x32)
-  0xDA, 0x02,         // set COM pins hardware configuration to sequential
-#endif
-  0x8D, 0x14,         // enable charge pump
-  0xAF,               // switch on OLED
-  0xA1, 0xC8          // flip the screen
-};
-
-// OLED init function
-void OLED_init(void) {
-  I2C_start(OLED_ADDR);                       // start transmission to OLED
-  I2C_write(OLED_CMD_MODE);                   // set command mode and send command bytes ...
-  for (uint8_t i = 0; i < OLED_INIT_LEN; i++) I2C_write(pgm_read_byte(&OLED_INIT_CMD[i]));
-  I2C_stop();                                 // stop transmission
-}
-
 // OLED plot a character
 void OLED_plotChar(char c) {
   uint16_t offset = c - 32;                   // calculate position of character in font array
@@ -197,6 +141,14 @@ void OLED_plotChar(char c) {
   for(uint8_t i=4; i; i--) I2C_write(0x00);   // print spacing between characters
   sine_ptr++;                                 // increase sine table pointer
   for(uint8_t i=5; i; i--) {                  // character consists of 5 lines
+#if defined(SINE_TABLE)
+    uint8_t  sh = pgm_read_byte(&SINE_SHIFT[sine_ptr & 0x7F]); // read shift value from table
+    uint16_t ln = pgm_read_byte(&OLED_FONT[offset++]) << (sh & 7); // shift line within two pages
+    for(uint8_t i=0; i<4; i++) {              // write the shifted line on the OLED ...
+      if(i < (sh >> 3)) I2C_write(0x00);      // pages above the line are empty
+      else {I2C_write(ln); ln >>= 8;}         // then the two pages of the line
+    }
+#else
     uint32_t ch = pgm_read_byte(&OLED_FONT[offset++]); // read line of character
     uint8_t  pt = sine_ptr & 0x1F;            // get quarter part of pointer
     if(sine_ptr & 0x20) pt = 0x1F - pt;       // mirror on the y-axis, if necessary
@@ -204,17 +156,18 @@ void OLED_plotChar(char c) {
     (pt & 1) ? (sh &= 0x0F) : (sh >>= 4);     // get correct nibble
     if(sine_ptr & 0x40) sh = 0x17 - sh;       // mirror on the x-axis, if necessary
     ch <<= sh;                                // shift char according to sine table value
-    sine_ptr++;                               // increase sine table pointer
     for(uint8_t i=4; i; i--) {                // write the shifted line on the OLED ...
       I2C_write(ch);
       ch >>= 8;
     }
+#endif
+    sine_ptr++;                               // increase sine table pointer
   }
 }
 
 // OLED print a string from program memory
 void OLED_print(const char* p) {
-  I2C_start(OLED_ADDR);                       // start transmission to OLED
+  OLED_START(return);                         // start transmission to OLED
   I2C_write(OLED_DAT_MODE);                   // set data mode
   char ch = pgm_read_byte(p);                 // read first character from program memory
   while (ch != 0) {                           // repeat until string terminator
@@ -224,17 +177,9 @@ void OLED_print(const char* p) {
   I2C_stop();                                 // stop transmission
 }
 
-// OLED clear screen
-void OLED_clear(void) {
-  I2C_start(OLED_ADDR);                       // start transmission to OLED
-  I2C_write(OLED_DAT_MODE);                   // set data mode
-  for(uint16_t i=16 * (MULTIPLEX + 1); i; i--) I2C_write(0x00);// clear the screen (we need (MULTIPLEX+1)*128 bits, so 16*(MULTIPLEX+1) bytes)
-  I2C_stop();                                 // stop transmission
-}
-
 // OLED crop display to useful zone
 void OLED_crop(void) {
-  I2C_start(OLED_ADDR);                       // start transmission to OLED
+  OLED_START(return);                         // start transmission to OLED
 
   // Set min and max pages. Probably not required for 128x32 since we
   // use the whole height.
@@ -263,13 +208,18 @@ void OLED_crop(void) {
 int main(void) {
   // Setup
   OLED_init();                                // initialize the OLED
+  PERF_init();                                // initialize instrumentation
+  FRAME_init();                               // initialize frame scheduler
   OLED_clear();                               // clear screen
   OLED_crop();
 
   // Loop
   while(1) {                                  // loop until forever                         
+    FRAME_wait();                             // sleep until the next frame is due
     // Animate messages
     OLED_print(Message);                      // print message
+    PERF_frame();                             // frame done (instrumentation)
+    OLED_ready();                             // display on after the first frame
     sine_ptr--;                               // shift whole wave to the right
   }
 }
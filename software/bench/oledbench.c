@@ -0,0 +1,157 @@
+// oledbench - cycle-accurate throughput benchmark for the TinyOLED demos
+//
+// Runs a demo firmware under simavr and attaches a virtual SSD1306 to the
+// bit-banged I2C pins (SDA = PB0, SCL = PB2). The lines are open drain, so
+// a pin is LOW when its DDR bit is set and HIGH (pulled up) when released.
+// The virtual slave decodes START/STOP conditions and bytes on the rising
+// SCL edges and counts them. The demo must be built with -DPERF_PIN=PB1;
+// every toggle of PB1 marks the end of a frame. -DPERF_NODELAY removes the
+// waits between the frames, so cycles/frame is the rendering cost only.
+//
+// The result is printed as one tab-separated line:
+// demo  mcu  f_cpu  flash  sram  frames  cycles/frame  bytes/frame
+//       transactions/frame  cycles/byte
+// cycles/byte only counts the cycles between START and STOP, so it is the
+// cost of the bus code itself, independent of any delays in the demo.
+//
+// Usage: oledbench [-h] [-f frames] [-s seconds] <mcu> <f_cpu> <elf> [name]
+//   -h          print the table header first
+//   -f frames   number of frames to measure (default 16)
+//   -s seconds  simulated time limit (default 20)
+//
+// 2021 by Stefan Wagner
+// Project Files (Github):  https://github.com/wagiminator
+// License: http://creativecommons.org/licenses/by-sa/3.0/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/avr_ioport.h>
+
+// Pin definitions (must match the demos)
+#define I2C_SDA         0                     // serial data pin  (PB0)
+#define I2C_SCL         2                     // serial clock pin (PB2)
+#define PERF_PIN        1                     // frame marker pin (PB1)
+
+// Virtual SSD1306 bus state
+static avr_t   *avr;                          // simulated MCU
+static int      sda = 1, scl = 1;             // current line levels
+static int      busy;                         // inside a transaction?
+static int      bits;                         // bits received of current byte
+static uint64_t bus_start;                    // cycle of the last START
+static uint64_t bus_cycles;                   // cycles spent inside transactions
+static uint64_t bytes;                        // I2C bytes received (incl. address)
+static uint64_t trans;                        // I2C transactions (START/STOP pairs)
+
+// Frame counter
+static int      frames = -1;                  // first marker only starts measuring
+static uint64_t frame_start;                  // cycle of the first frame marker
+static uint64_t frame_end;                    // cycle of the last frame marker
+static uint64_t bytes_start, trans_start;     // counters at the first frame marker
+static uint64_t cycles_start;                 // bus cycles at the first frame marker
+
+// DDRB changed: decode the I2C lines
+static void ddr_hook(struct avr_irq_t *irq, uint32_t value, void *param) {
+  int nsda = !(value & (1<<I2C_SDA));         // released -> pulled HIGH
+  int nscl = !(value & (1<<I2C_SCL));
+  if(scl && nscl && sda && !nsda) {           // SDA falls while SCL HIGH
+    busy = 1; bits = 0;                       // -> START condition
+    bus_start = avr->cycle;
+  }
+  else if(scl && nscl && !sda && nsda) {      // SDA rises while SCL HIGH
+    if(busy) {                                // -> STOP condition
+      busy = 0; trans++;
+      bus_cycles += avr->cycle - bus_start;
+    }
+  }
+  else if(busy && !scl && nscl) {             // rising SCL edge -> slave reads bit
+    if(++bits == 9) {                         // 8 data bits + ACK bit
+      bits = 0; bytes++;
+    }
+  }
+  sda = nsda; scl = nscl;
+}
+
+// PB1 changed: one frame is complete
+static void frame_hook(struct avr_irq_t *irq, uint32_t value, void *param) {
+  if(++frames == 0) {                         // first marker: start measuring
+    frame_start  = avr->cycle;
+    bytes_start  = bytes;
+    trans_start  = trans;
+    cycles_start = bus_cycles;
+  }
+  frame_end = avr->cycle;
+}
+
+int main(int argc, char **argv) {
+  int header = 0, want = 16, seconds = 20, opt;
+  while((opt = getopt(argc, argv, "hf:s:")) != -1) {
+    switch(opt) {
+      case 'h': header  = 1;            break;
+      case 'f': want    = atoi(optarg); break;
+      case 's': seconds = atoi(optarg); break;
+      default:  goto usage;
+    }
+  }
+  if(argc - optind < 3) goto usage;
+  const char *mcu  = argv[optind];
+  uint32_t    freq = strtoul(argv[optind + 1], NULL, 0);
+  const char *elf  = argv[optind + 2];
+  const char *name = (argc - optind > 3) ? argv[optind + 3] : elf;
+
+  if(header)
+    printf("demo\tmcu\tf_cpu\tflash\tsram\tframes\tcycles/frame\tbytes/frame\t"
+           "transactions/frame\tcycles/byte\n");
+
+  // Load firmware
+  elf_firmware_t fw;
+  memset(&fw, 0, sizeof(fw));
+  if(elf_read_firmware(elf, &fw)) {
+    fprintf(stderr, "oledbench: unable to load %s\n", elf);
+    return 1;
+  }
+  uint32_t flash = fw.flashsize;              // .text + .data (data image is in flash)
+  uint32_t sram  = fw.datasize + fw.bsssize;
+
+  // Create simulated MCU
+  avr = avr_make_mcu_by_name(mcu);
+  if(!avr) {                                  // core not supported by simavr
+    printf("%s\t%s\t%u\t%u\t%u\tn/a\tn/a\tn/a\tn/a\tn/a\n", name, mcu, freq, flash, sram);
+    return 0;
+  }
+  avr_init(avr);
+  avr->frequency = freq;
+  avr_load_firmware(avr, &fw);
+
+  // Attach virtual SSD1306 and frame marker
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'),
+                          IOPORT_IRQ_DIRECTION_ALL), ddr_hook, NULL);
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'),
+                          PERF_PIN), frame_hook, NULL);
+
+  // Run until enough frames are measured or the time limit is reached
+  uint64_t limit = (uint64_t)freq * seconds;
+  int state = cpu_Running;
+  while(frames < want && avr->cycle < limit &&
+        state != cpu_Done && state != cpu_Crashed) state = avr_run(avr);
+
+  if(frames < 1) {                            // no complete frame measured
+    printf("%s\t%s\t%u\t%u\t%u\t0\tn/a\tn/a\tn/a\tn/a\n", name, mcu, freq, flash, sram);
+    return 0;
+  }
+  uint64_t nbytes = bytes - bytes_start;
+  printf("%s\t%s\t%u\t%u\t%u\t%d\t%llu\t%llu\t%llu\t%.1f\n", name, mcu, freq, flash, sram,
+         frames,
+         (unsigned long long)((frame_end - frame_start) / frames),
+         (unsigned long long)(nbytes / frames),
+         (unsigned long long)((trans - trans_start) / frames),
+         nbytes ? (double)(bus_cycles - cycles_start) / nbytes : 0.0);
+  return 0;
+
+usage:
+  fprintf(stderr, "usage: oledbench [-h] [-f frames] [-s seconds] <mcu> <f_cpu> <elf> [name]\n");
+  return 1;
+}
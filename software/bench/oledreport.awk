@@ -0,0 +1,84 @@
+# oledreport - size and throughput report of the TinyOLED demos
+#
+# Compares the table written by "make report" with a stored baseline and
+# prints flash, SRAM and cycles per frame of every demo and screen together
+# with the change against the baseline, so the flash cost of a speed-up (and
+# the other way round) shows up in one table.
+#
+# Both files have one tab-separated line per demo and screen:
+# screen  demo  mcu  f_cpu  flash  sram  frames  cycles/frame  bytes/frame
+#         transactions/frame  cycles/byte
+# A demo that did not build has "failed" in the mcu column, a demo that does
+# not support the screen has "n/a". Lines starting with "#" are comments.
+#
+# Usage: awk -f oledreport.awk <baseline> <report>
+# The baseline may be /dev/null, all demos are reported as new then. Demos
+# that exceed the flash of their MCU are marked with "FLASH", demos that got
+# bigger or slower with "+".
+#
+# 2021 by Stefan Wagner
+# Project Files (Github):  https://github.com/wagiminator
+# License: http://creativecommons.org/licenses/by-sa/3.0/
+
+BEGIN {
+  FS = OFS = "\t"
+  limit["attiny10"]  = 1024                   # flash size of the MCUs
+  limit["attiny13a"] = 1024
+  limit["attiny13"]  = 1024
+  limit["attiny202"] = 2048
+  print "screen", "demo", "mcu", "flash", "+/-", "sram", "+/-",
+        "cycles/frame", "+/-", "fps", "bytes/frame", "note"
+}
+
+# Change of a value against the baseline
+function delta(cur, base) {
+  if(base == "") return "new"
+  if(cur !~ /^[0-9]+$/ || base !~ /^[0-9]+$/) return "-"
+  return sprintf("%+d", cur - base)
+}
+
+# Comments (the header of the baseline)
+/^#/ {next}
+
+# Baseline: remember the values of each demo and screen
+FILENAME == ARGV[1] {
+  key = $1 FS $2
+  bflash[key] = $5; bsram[key] = $6; bcycles[key] = $8
+  next
+}
+
+# Report: one line per demo and screen
+{
+  key = $1 FS $2; seen[key] = 1
+  if($3 == "n/a") {
+    print $1, $2, "-", "-", "-", "-", "-", "-", "-", "-", "-", "n/a"
+    next
+  }
+  if($3 == "failed") {
+    print $1, $2, "-", "-", "-", "-", "-", "-", "-", "-", "-", "build failed"
+    failed++
+    next
+  }
+  note = ""
+  if(($3 in limit) && $5 > limit[$3]) {note = "FLASH"; full++}
+  dc = "-"; fps = "-"
+  if($8 ~ /^[0-9]+$/ && $8 > 0) {
+    fps = sprintf("%.1f", $4 / $8)
+    if(bcycles[key] ~ /^[0-9]+$/ && bcycles[key] > 0)
+      dc = sprintf("%+.1f%%", ($8 - bcycles[key]) * 100 / bcycles[key])
+  }
+  if((key in bflash) && ($5 > bflash[key] || dc ~ /^\+[0-9.]*[1-9]/)) {
+    note = note (note ? " " : "") "+"; worse++
+  }
+  print $1, $2, $3, $5, delta($5, bflash[key]), $6, delta($6, bsram[key]),
+        $8, dc, fps, $9, note
+}
+
+END {
+  for(key in bflash) if(!(key in seen)) {     # demos no longer in the report
+    split(key, k, FS)
+    print k[1], k[2], "-", "-", "-", "-", "-", "-", "-", "-", "-", "removed"
+  }
+  printf("%d bigger or slower, %d over the flash size, %d failed\n",
+         worse, full, failed) > "/dev/stderr"
+}
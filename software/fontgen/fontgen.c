@@ -0,0 +1,230 @@
+// fontgen - font variant generator for the TinyOLED demos
+//
+// Reads the 5x8 OLED_FONT table from the tinyOLED library (or a sketch) and
+// writes it to stdout as a header file (oled_font.h). The sketch includes this header instead of its
+// built-in table when OLED_FONT_HEADER is defined, the printing functions stay
+// the same. Two formats are available:
+//
+// plain   5 bytes per glyph, like the built-in table.
+// packed  2 glyphs in 9 bytes. Almost all columns of the font only use the
+//         lower 7 bits. The middle column of each glyph is split: its upper 4
+//         bits are stored in bit 7 of the other four columns, its lower 4 bits
+//         in the nibble byte after the glyph pair (low nibble: even glyph,
+//         high nibble: odd glyph). Decoding is a few shifts per character, so
+//         the I2C byte loop is not slowed down.
+//
+// pair:   A0 A1 A3 A4  B0 B1 B3 B4  (B2 & 0x0F) << 4 | (A2 & 0x0F)
+// bit 7 of column 0, 1, 3, 4 = bit 4, 5, 6, 7 of the middle column
+//
+// The glyph range can be trimmed with -r, e.g. -r 0x20-0x5A drops the last
+// five glyphs. OLED_FONT_FIRST is defined in the header accordingly.
+//
+// With -s only the glyphs of characters that appear in the PROGMEM strings of
+// the given files are kept (plus the space). The header then also contains the
+// translation table OLED_FONT_MAP (one byte per character from OLED_FONT_FIRST
+// to OLED_FONT_LAST), which gives the glyph number of each character. Unused
+// characters map to the space.
+//
+// Usage: fontgen [-p] [-r first-last | -s] <sketch> [<file> ...]
+//   e.g. fontgen -s TinyOLEDdemo_t13_text.ino ../tinyOLED/tinyOLED.h
+//   -p              write the packed format
+//   -r first-last   glyph range to keep (default: all glyphs of the sketch)
+//   -s              keep only the glyphs used by the PROGMEM strings
+//
+// 2021 by Stefan Wagner
+// Project Files (Github):  https://github.com/wagiminator
+// License: http://creativecommons.org/licenses/by-sa/3.0/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Font definitions (must match the demos)
+#define FONT_FIRST      32                    // first character of the built-in font
+#define FONT_WIDTH      5                     // columns per glyph
+#define FONT_MAX        96                    // maximum number of glyphs
+
+static unsigned char font[FONT_MAX][FONT_WIDTH]; // glyphs read from the sketch
+static int           glyphs;                  // number of glyphs read
+static int           used[256];               // characters used by the PROGMEM strings
+static char          src[1 << 17];            // source code of all files
+
+// Append a source file to src, return 0 on success
+static int read_file(const char *name) {
+  static size_t len;
+  FILE *f = fopen(name, "rb");
+  if(!f) return -1;
+  len += fread(src + len, 1, sizeof(src) - 1 - len, f);
+  fclose(f);
+  src[len] = 0;
+  return 0;
+}
+
+// Mark all characters of the PROGMEM strings (char ... PROGMEM = "..." "...";)
+static void scan_strings(void) {
+  for(char *p = src; (p = strstr(p, "PROGMEM")); ) {
+    char *decl = p;                           // only char arrays are strings
+    while(decl > src && decl[-1] != '\n' && decl[-1] != ';') decl--;
+    p += 7;
+    if(!strstr(decl, "char") || strstr(decl, "char") > p) continue;
+    if(!(p = strchr(p, '='))) return;
+    while(*p && *p != ';') {                  // all literals up to the semicolon
+      if(*p++ != '"') continue;
+      for(; *p && *p != '"'; p++) {
+        if(*p == '\\' && p[1]) p++;           // escaped character
+        used[(unsigned char)*p] = 1;
+      }
+      if(*p) p++;
+    }
+  }
+}
+
+// Read the OLED_FONT table of the sketch, return 0 on success
+static int read_font(void) {
+  char *p = strstr(src, "OLED_FONT[] PROGMEM");       // table of a sketch
+  if(!p) p = strstr(src, "OLED_FONT[] OLED_PROGMEM"); // table of the library
+  if(!p || !(p = strchr(p, '{'))) return -1;
+  char *end = strstr(p, "};");
+  if(!end) return -1;
+  int n = 0;
+  while((p = strstr(p, "0x")) && p < end) {   // every hex value is a column
+    if(n == FONT_MAX * FONT_WIDTH) return -1;
+    font[n / FONT_WIDTH][n % FONT_WIDTH] = strtoul(p, &p, 16);
+    n++;
+  }
+  if(n % FONT_WIDTH) return -1;
+  glyphs = n / FONT_WIDTH;
+  return 0;
+}
+
+// Print the comment of one glyph
+static void print_name(int c) {
+  if(c == '\\') printf(" bslash");
+  else          printf(" %c", c);
+}
+
+int main(int argc, char **argv) {
+  int packed = 0, subset = 0, first = -1, last = -1, opt;
+  while((opt = getopt(argc, argv, "pr:s")) != -1) {
+    switch(opt) {
+      case 'p': packed = 1; break;
+      case 's': subset = 1; break;
+      case 'r': {
+        char *s;
+        first = strtol(optarg, &s, 0);
+        if(*s++ != '-') goto usage;
+        last  = strtol(s, NULL, 0);
+        break;
+      }
+      default:  goto usage;
+    }
+  }
+  if(argc - optind < 1 || (subset && first >= 0)) goto usage;
+  const char *sketch = argv[optind];
+
+  for(int i = optind; i < argc; i++) {
+    if(read_file(argv[i])) {
+      fprintf(stderr, "fontgen: cannot read %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if(read_font()) {
+    fprintf(stderr, "fontgen: no OLED_FONT table found\n");
+    return 1;
+  }
+
+  // Select the glyphs to keep
+  int chars[FONT_MAX], count = 0;             // characters of the kept glyphs
+  if(subset) {
+    scan_strings();
+    used[' '] = 1;                            // unused characters map to the space
+    first = FONT_FIRST;                       // space is the first character of the map
+    for(int c = 0; c < 256; c++) {
+      if(!used[c]) continue;
+      if(c < FONT_FIRST || c >= FONT_FIRST + glyphs) {
+        fprintf(stderr, "fontgen: character 0x%02X of a string is not in the font\n", c);
+        return 1;
+      }
+      last = c;
+    }
+    for(int c = first; c <= last; c++) if(used[c]) chars[count++] = c;
+  }
+  else {
+    if(first < 0) { first = FONT_FIRST; last = FONT_FIRST + glyphs - 1; }
+    if(first < FONT_FIRST || last >= FONT_FIRST + glyphs || last < first) {
+      fprintf(stderr, "fontgen: range 0x%02X-0x%02X outside of font 0x%02X-0x%02X\n",
+              first, last, FONT_FIRST, FONT_FIRST + glyphs - 1);
+      return 1;
+    }
+    for(int c = first; c <= last; c++) chars[count++] = c;
+  }
+
+  // Check whether the font can be packed
+  if(packed) {
+    for(int i = 0; i < count; i++) {
+      unsigned char *g = font[chars[i] - FONT_FIRST];
+      if((g[0] | g[1] | g[3] | g[4]) & 0x80) {
+        fprintf(stderr, "fontgen: glyph 0x%02X uses bit 7 outside the middle column\n", chars[i]);
+        return 1;
+      }
+    }
+  }
+  int size = packed ? ((count + 1) / 2) * 9 : count * FONT_WIDTH;
+  if(subset) size += last - first + 1;
+
+  // Write the header
+  const char *base = strrchr(sketch, '/');
+  printf("// oled_font.h - generated by fontgen from %s, do not edit\n", base ? base + 1 : sketch);
+  printf("// %s%s 5x8 font, %d glyphs (0x%02X..0x%02X), %d bytes\n\n",
+         packed ? "packed" : "plain", subset ? " subset" : "", count, first, last, size);
+  if(packed) printf("#define OLED_FONT_PACKED\n");
+  if(subset) printf("#define OLED_FONT_SUBSET\n");
+  printf("#define OLED_FONT_FIRST 0x%02X\n", first);
+  printf("#define OLED_FONT_LAST  0x%02X\n\n", last);
+  if(subset) {
+    printf("const uint8_t OLED_FONT_MAP[] OLED_PROGMEM = {\n");
+    for(int c = first; c <= last; c++) {
+      int g = 0;                              // glyph number, unused: space
+      for(int i = 0; i < count; i++) if(chars[i] == (used[c] ? c : ' ')) g = i;
+      printf("%s%2d%s", (c - first) % 16 ? " " : "  ", g, (c < last) ? "," : "\n");
+      if(c < last && (c - first) % 16 == 15) printf("\n");
+    }
+    printf("};\n\n");
+  }
+  printf("const uint8_t OLED_FONT[] OLED_PROGMEM = {\n");
+  if(packed) {
+    for(int i = 0; i < count; i += 2) {
+      unsigned char *a = font[chars[i] - FONT_FIRST];
+      unsigned char  z[FONT_WIDTH] = {0};     // odd glyph count: pad with blank glyph
+      unsigned char *b = (i + 1 < count) ? font[chars[i + 1] - FONT_FIRST] : z;
+      unsigned char *g[2] = {a, b};
+      printf(" ");
+      for(int k = 0; k < 2; k++) {
+        unsigned char m = g[k][2];            // middle column, upper 4 bits to bit 7
+        printf(" 0x%02X, 0x%02X, 0x%02X, 0x%02X,",
+               g[k][0] | ((m << 3) & 0x80), g[k][1] | ((m << 2) & 0x80),
+               g[k][3] | ((m << 1) & 0x80), g[k][4] | (m & 0x80));
+      }
+      printf(" 0x%02X%s //", ((b[2] & 0x0F) << 4) | (a[2] & 0x0F), (i + 2 < count) ? "," : " ");
+      print_name(chars[i]);
+      if(i + 1 < count) print_name(chars[i + 1]);
+      printf("\n");
+    }
+  }
+  else {
+    for(int i = 0; i < count; i++) {
+      unsigned char *g = font[chars[i] - FONT_FIRST];
+      printf("  0x%02X, 0x%02X, 0x%02X, 0x%02X, 0x%02X%s //",
+             g[0], g[1], g[2], g[3], g[4], (i + 1 < count) ? "," : " ");
+      print_name(chars[i]);
+      printf("\n");
+    }
+  }
+  printf("};\n");
+  return 0;
+
+usage:
+  fprintf(stderr, "usage: fontgen [-p] [-r first-last | -s] <sketch> [<file> ...]\n");
+  return 1;
+}
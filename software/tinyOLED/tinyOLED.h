@@ -0,0 +1,1658 @@
+// tinyOLED - shared I2C and SSD1306 OLED driver for the TinyOLED demos
+//
+// This header contains the bus and display code that all demo sketches have
+// in common. It is header-only: the sketch selects the configuration with the
+// macros below and then includes this file. Everything is resolved at compile
+// time, the build uses -flto, so functions and tables that a demo does not use
+// cost no flash at all. Everything else (fonts for big numbers, sine tables,
+// plotting functions) stays in the sketch.
+//
+// Bus backend (selected by the MCU):
+// - ATtiny10/13: bit-banged I2C on I2C_SDA/I2C_SCL (default PB0/PB2)
+//   I2C_ASM          hand-scheduled assembly I2C_write
+//   I2C_SDA2         data pin of a second OLED on the same SCL, both get the
+//                    same data bits in the same bit loop (mirror), only the
+//                    address byte differs: OLED_ADDR2 (default OLED_ADDR ^ 2,
+//                    the other SA0 jumper, define it as OLED_ADDR for two
+//                    panels with the same address)
+//   I2C_ACKCHECK     check the ACK of the slave address, skip the frame and
+//                    recover the bus if the OLED does not answer
+//   F_CPU            ATtiny10: 8, 4 (default in the makefiles), 2 or 1 MHz,
+//                    set by CLK_init()
+// - ATtiny202 (has TWI0): hardware TWI master
+//   I2C_FREQ         SCL frequency in Hz (default 400000)
+//   I2C_AUTOTUNE     find the fastest SCL frequency on startup, keep it in EEPROM
+//   I2C_INTERRUPT    interrupt-driven transmit queue
+//   I2C_BUFFER       ping-pong render buffers for the queue (needs I2C_INTERRUPT)
+//
+// Screen geometry:
+//   SCREEN_128x32 or SCREEN_128x64 (default 128x32) -> OLED_PAGES
+//   OLED_MODE        memory addressing mode set by OLED_INIT_CMD: OLED_HORIZONTAL
+//                    (default), OLED_VERTICAL or OLED_PAGE
+//   OLED_FLIP        rotate the screen by 180 degrees
+//   OLED_PAGE_FIRST  first and last page of the addressing window (default the
+//   OLED_PAGE_LAST   whole screen), not used in OLED_PAGE mode
+// From these settings the init sequence OLED_INIT_CMD is generated at compile
+// time. It contains only the commands that differ from the SSD1306 reset state.
+// A sketch may instead define OLED_INIT_LEN (number of bytes to send) and its
+// own OLED_INIT_CMD after including this file, with OLED_PROGMEM.
+//
+// Features:
+//   OLED_PRINT       5x8 font, OLED_printC, OLED_printP
+//   OLED_FONT_HEADER use the font variant oled_font.h generated by fontgen
+//   OLED_FONT_PROP   proportional font: glyphs without their blank columns,
+//                    OLED_SPACE_WIDTH (default 3) columns for a space
+//   OLED_BATCH       OLED_printT, print a table of strings (needs OLED_PRINT)
+//   OLED_BLOCK       OLED_printV, print a block of lines column by column in
+//                    vertical addressing mode (needs OLED_PRINT)
+//   OLED_FASTCLEAR   OLED_clear with one data stream over a full-screen window,
+//                    the cheapest command sequence for OLED_MODE and window
+//   OLED_SPRITE      OLED_sprite, draw a bitmap at any pixel row, OLED_fill
+//   PERF_PIN         toggle this pin after every frame (PBx, ATtiny202: PINx_bm)
+//   PERF_COUNT       count I2C bytes, transactions and frames per second
+//   FRAME_FPS        sleep between the frames, wake up at this frame rate
+//   UART_RX          receive text (8N1, UART_BAUD default 9600) on this pin
+//                    (ATtiny202: the USART on PA7, define it as 1) into a
+//                    small FIFO, OLED_terminal prints it (needs OLED_PRINT)
+//   OLED_FASTBOOT    wait only OLED_BOOT_MS (default 20) after power-up, or
+//                    until the OLED answers with I2C_ACKCHECK, and keep the
+//                    display off until OLED_ready() after the first frame
+//
+// Usage in the Arduino IDE: copy this folder into your libraries folder. The
+// makefiles of the demos add it to the include path.
+//
+// 2021 by Stefan Wagner
+// Project Files (Github):  https://github.com/wagiminator
+// License: http://creativecommons.org/licenses/by-sa/3.0/
+
+#ifndef TINYOLED_H
+#define TINYOLED_H
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+
+// -----------------------------------------------------------------------------
+// Configuration
+// -----------------------------------------------------------------------------
+
+#if defined(SCREEN_128x32) && defined(SCREEN_128x64)
+#error "Please define either SCREEN_128x32 or SCREEN_128x64 but not both!"
+#endif
+
+// OLED address, also used by the I2C auto-tuning
+#if !defined(OLED_ADDR)
+#define OLED_ADDR       0x78                  // OLED write address (0x7A: other jumper)
+#endif
+
+#if defined(SCREEN_128x64)
+#define OLED_PAGES      8                     // number of pages (8 pixel rows each)
+#else
+#define OLED_PAGES      4
+#endif
+
+// Memory addressing modes
+#define OLED_HORIZONTAL 0x00                  // horizontal addressing mode
+#define OLED_VERTICAL   0x01                  // vertical addressing mode
+#define OLED_PAGE       0x02                  // page addressing mode
+#if !defined(OLED_MODE)
+#define OLED_MODE       OLED_HORIZONTAL       // addressing mode set by OLED_INIT_CMD
+#endif
+
+#if !defined(OLED_PAGE_FIRST)
+#define OLED_PAGE_FIRST 0                     // first page of the addressing window
+#endif
+#if !defined(OLED_PAGE_LAST)
+#define OLED_PAGE_LAST  (OLED_PAGES - 1)      // last page of the addressing window
+#endif
+
+// Access to constant tables. The flash of the ATtiny10 and ATtiny202 is mapped
+// into the data space and can be read directly, the ATtiny13 needs LPM.
+#if defined(TWI0)
+#define OLED_PROGMEM                          // const data is mapped automatically
+#else
+#define OLED_PROGMEM    PROGMEM
+#endif
+#if defined(TWI0) || defined(__AVR_TINY__)
+#define OLED_READ(p)    (*(const uint8_t*)(p))
+#define OLED_READP(p)   (*(const char* const*)(p))
+#else
+#define OLED_READ(p)    pgm_read_byte(p)
+#define OLED_READP(p)   ((const char*)pgm_read_word(p))
+#endif
+
+#if defined(__AVR_TINY__)
+// -----------------------------------------------------------------------------
+// System Clock (ATtiny10)
+// -----------------------------------------------------------------------------
+
+// The ATtiny10 runs from the 8 MHz oscillator, the prescaler is derived from
+// F_CPU (CLOCK in the makefile). 4 MHz is the default; 8 MHz doubles the frame
+// rate but needs a supply voltage of at least 2.7V. The bit-banged I2C is timed
+// for both, the CPU is stopped between the frames anyway (FRAME_FPS).
+#if   F_CPU == 8000000
+#define CLK_PSR         0                     // prescaler 1 -> 8 MHz
+#elif F_CPU == 4000000
+#define CLK_PSR         1                     // prescaler 2 -> 4 MHz
+#elif F_CPU == 2000000
+#define CLK_PSR         2                     // prescaler 4 -> 2 MHz
+#elif F_CPU == 1000000
+#define CLK_PSR         3                     // prescaler 8 -> 1 MHz
+#else
+#error "F_CPU must be 8, 4, 2 or 1 MHz on the ATtiny10!"
+#endif
+
+// Clock init function
+void CLK_init(void) {
+  CCP    = 0xD8;                              // unlock register protection
+  CLKPSR = CLK_PSR;                           // set clock prescaler
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// Instrumentation (optional)
+// -----------------------------------------------------------------------------
+
+#if defined(PERF_COUNT)
+// Counters of the current measuring window (about one second)
+volatile uint32_t PERF_bytes;                 // I2C bytes sent
+volatile uint16_t PERF_trans;                 // I2C transactions (start/stop pairs)
+volatile uint16_t PERF_frames;                // frames completed
+
+// Results of the last measuring window (read them with a debugger or simulator)
+volatile uint32_t PERF_bps;                   // I2C bytes per second
+volatile uint16_t PERF_tps;                   // I2C transactions per second
+volatile uint16_t PERF_fps;                   // frames per second
+
+// Latch the counters of the measuring window
+#define PERF_LATCH() \
+  PERF_bps = PERF_bytes;  PERF_bytes  = 0;    /* latch and reset byte counter        */ \
+  PERF_tps = PERF_trans;  PERF_trans  = 0;    /* latch and reset transaction counter */ \
+  PERF_fps = PERF_frames; PERF_frames = 0;    /* latch and reset frame counter       */
+
+#if defined(TWI0)
+// TCA0 overflow interrupt: latch the counters once per second
+ISR(TCA0_OVF_vect) {
+  TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm;   // clear interrupt flag
+  PERF_LATCH();
+}
+#elif defined(__AVR_TINY__)
+// Timer0 compare match interrupt: latch the counters once per second
+ISR(TIM0_COMPA_vect) {
+  PERF_LATCH();
+}
+#else
+#define PERF_OVF_PER_SEC  (F_CPU / 1024 / 256)    // Timer0 overflows per second (approx.)
+volatile uint8_t  PERF_ovf;                   // Timer0 overflows
+
+// Timer0 overflow interrupt: latch the counters about once per second
+ISR(TIM0_OVF_vect) {
+  if(++PERF_ovf < PERF_OVF_PER_SEC) return;   // not a second yet? -> nothing to do
+  PERF_ovf = 0;                               // start next measuring window
+  PERF_LATCH();
+}
+#endif
+
+// Count in main code: the interrupt latches and resets the counters, so the
+// multi-byte increment must not be split by it
+#define PERF_INC(cnt)   do {cli(); cnt++; sei();} while(0)
+#define PERF_BYTE()     PERF_INC(PERF_bytes)  // count one I2C byte
+#define PERF_START()    PERF_INC(PERF_trans)  // count one I2C transaction
+#else
+#define PERF_BYTE()
+#define PERF_START()
+#endif
+
+// Instrumentation init function
+void PERF_init(void) {
+#if defined(PERF_PIN) && defined(TWI0)
+  PORTA.DIRSET = PERF_PIN;                    // timing pin as output
+#elif defined(PERF_PIN)
+  DDRB  |= (1<<PERF_PIN);                     // timing pin as output
+#endif
+#if defined(PERF_COUNT)
+#if defined(TWI0)
+  TCA0.SINGLE.PER     = F_CPU / 1024 - 1;     // one overflow per second
+  TCA0.SINGLE.INTCTRL = TCA_SINGLE_OVF_bm;    // enable overflow interrupt
+  TCA0.SINGLE.CTRLA   = TCA_SINGLE_CLKSEL_DIV1024_gc | TCA_SINGLE_ENABLE_bm; // start TCA0
+#elif defined(__AVR_TINY__)
+  OCR0A  = F_CPU / 1024 - 1;                  // 16-bit Timer0: one compare match per second
+  TCCR0B = (1<<WGM02) | (1<<CS02) | (1<<CS00); // start Timer0 in CTC mode, prescaler 1024
+  TIMSK0 = (1<<OCIE0A);                       // enable compare match interrupt
+#else
+  TCCR0B = (1<<CS02) | (1<<CS00);             // start Timer0 with prescaler 1024
+  TIMSK0 = (1<<TOIE0);                        // enable overflow interrupt
+#endif
+  sei();                                      // enable global interrupts
+#endif
+}
+
+// Instrumentation: mark the end of a frame
+void PERF_frame(void) {
+#if defined(PERF_PIN) && defined(TWI0)
+  PORTA.OUTTGL = PERF_PIN;                    // toggle timing pin
+#elif defined(PERF_PIN)
+  PINB = (1<<PERF_PIN);                       // toggle timing pin
+#endif
+#if defined(PERF_COUNT)
+  PERF_INC(PERF_frames);                      // count completed frame
+#endif
+}
+
+#if defined(TWI0)
+// -----------------------------------------------------------------------------
+// I2C Master Implementation (Write only) - hardware TWI
+// -----------------------------------------------------------------------------
+
+#if !defined(I2C_FREQ)
+#define I2C_FREQ  400000UL                        // I2C clock frequency in Hz
+#endif
+#define I2C_BAUD  ((F_CPU / I2C_FREQ) - 10) / 2   // simplified BAUD calculation
+
+#if defined(I2C_AUTOTUNE)
+#include <avr/eeprom.h>
+
+// I2C clock auto-tuning. The simplified BAUD calculation ignores the rise time
+// of the bus lines, and the panels of different vendors do not all accept the
+// same clock. So on the first start the fastest BAUD value is searched at which
+// the slave acknowledges every byte without bus error or arbitration loss. It
+// is stored together with a tag for F_CPU in the EEPROM. On later starts the
+// stored value is checked once and only tuned again if that check fails.
+#if !defined(I2C_TUNE_MIN)
+#define I2C_TUNE_MIN    100000UL                  // safe start frequency in Hz
+#endif
+#if !defined(I2C_TUNE_MAX)
+#define I2C_TUNE_MAX    1000000UL                 // never faster than this (fast mode plus)
+#endif
+#if !defined(I2C_TUNE_ADDR)
+#define I2C_TUNE_ADDR   OLED_ADDR                 // write address of the tested slave
+#endif
+#if !defined(I2C_TUNE_EEP)
+#define I2C_TUNE_EEP    0                         // EEPROM address of the BAUD value and tag
+#endif
+#define I2C_TUNE_TAG    ((uint8_t)(F_CPU / 100000)) // stored value is valid for this F_CPU only
+#define I2C_TUNE_PASSES 4                         // tests a value must pass in a row
+#define I2C_TUNE_MARGIN 1                         // BAUD steps added to the fastest value
+#define I2C_BAUDF(f)    ((F_CPU / (f)) > 10 ? ((F_CPU / (f)) - 10) / 2 : 0) // BAUD for f
+
+// I2C set the BAUD value. MBAUD may only be written while the master is
+// disabled, so the master is switched off and on again around it.
+void I2C_baud(uint8_t baud) {
+  TWI0.MCTRLA  = 0;                               // disable TWI master
+  TWI0.MBAUD   = baud;                            // set BAUD value
+  TWI0.MCTRLA  = TWI_ENABLE_bm;                   // enable TWI master
+  TWI0.MSTATUS = TWI_BUSSTATE_IDLE_gc;            // force bus state to idle
+}
+
+// I2C wait for the last transfer, return 1 if it was acknowledged without error
+uint8_t I2C_ack(void) {
+  uint8_t st;
+  while(!((st = TWI0.MSTATUS) & TWI_WIF_bm));     // wait for last transfer to complete
+  return !(st & (TWI_RXACK_bm | TWI_ARBLOST_bm | TWI_BUSERR_bm));
+}
+
+// I2C test a BAUD value: the address and a few OLED NOP commands must be acknowledged
+uint8_t I2C_test(uint8_t baud) {
+  I2C_baud(baud);                                 // set BAUD value to test
+  TWI0.MADDR = I2C_TUNE_ADDR;                     // start sending address
+  uint8_t ok = I2C_ack();                         // slave there?
+  for(uint8_t i = 8; i && ok; i--) {              // then 8 bytes ...
+    TWI0.MDATA = (i == 8) ? 0x00 : 0xE3;          // ... command mode, NOP commands
+    ok = I2C_ack();                               // acknowledged?
+  }
+  TWI0.MCTRLB  = TWI_MCMD_STOP_gc;                // send stop condition
+  while((TWI0.MSTATUS & TWI_BUSSTATE_gm) == TWI_BUSSTATE_OWNER_gc); // wait until it is out
+  TWI0.MSTATUS = TWI_ARBLOST_bm | TWI_BUSERR_bm | TWI_BUSSTATE_IDLE_gc; // clear errors
+  return ok;
+}
+
+// I2C find and store the fastest BAUD value, return the default if no slave answers
+uint8_t I2C_tune(void) {
+  uint8_t baud = I2C_BAUDF(I2C_TUNE_MIN);         // start with the safe value
+  if(!I2C_test(baud)) return I2C_BAUD;            // no slave -> default, nothing stored
+  uint8_t steps = 0;                              // faster values that passed
+  while(baud > I2C_BAUDF(I2C_TUNE_MAX)) {         // step the clock up ...
+    uint8_t i = I2C_TUNE_PASSES;
+    while(i && I2C_test(baud - 1)) i--;           // ... next value must pass every test
+    if(i) break;                                  // failed -> keep the last good value
+    baud--; steps++;
+  }
+  if(steps) baud += I2C_TUNE_MARGIN;              // headroom, never slower than the safe value
+  eeprom_update_byte((uint8_t*)I2C_TUNE_EEP, baud);                // store BAUD value ...
+  eeprom_update_byte((uint8_t*)I2C_TUNE_EEP + 1, I2C_TUNE_TAG);    // ... and F_CPU tag
+  return baud;
+}
+#endif
+
+// I2C init function
+void I2C_init(void) {
+  TWI0.MBAUD   = I2C_BAUD;                        // set TWI master BAUD rate
+  TWI0.MCTRLA  = TWI_ENABLE_bm;                   // enable TWI master
+  TWI0.MSTATUS = TWI_BUSSTATE_IDLE_gc;            // set bus state to idle
+#if defined(I2C_AUTOTUNE)
+  uint8_t baud = eeprom_read_byte((uint8_t*)I2C_TUNE_EEP); // BAUD value of the last tuning
+  if((eeprom_read_byte((uint8_t*)I2C_TUNE_EEP + 1) != I2C_TUNE_TAG) || !I2C_test(baud))
+    baud = I2C_tune();                            // none or not working -> tune again
+  I2C_baud(baud);                                 // set tuned BAUD rate
+#endif
+#if defined(I2C_INTERRUPT)
+  sei();                                          // enable global interrupts
+#endif
+}
+
+#if defined(I2C_BUFFER) && !defined(I2C_INTERRUPT)
+#error "I2C_BUFFER needs I2C_INTERRUPT!"
+#endif
+#if defined(I2C_ACKCHECK)
+#error "I2C_ACKCHECK is only available for the bit-banged I2C!"
+#endif
+#if defined(I2C_SDA2)
+#error "I2C_SDA2 is only available for the bit-banged I2C (one SDA, no RAM to replay a frame)!"
+#endif
+
+#if defined(I2C_INTERRUPT)
+
+// I2C transmit queue definitions
+#if !defined(I2C_QUEUE_SIZE)
+#if defined(I2C_BUFFER)
+#define I2C_QUEUE_SIZE  8                         // data goes through the render buffers
+#else
+#define I2C_QUEUE_SIZE  16                        // number of entries (must be a power of 2)
+#endif
+#endif
+#define I2C_QUEUE_START 0x0100                    // flag: entry is an address -> start condition
+#define I2C_QUEUE_STOP  0x0200                    // flag: entry is a stop condition
+#define I2C_QUEUE_BUF   0x0400                    // flag: entry is a render buffer, low byte: length
+#define I2C_QUEUE_BUF1  0x0800                    // flag: second render buffer
+
+// I2C transmit queue (ring buffer)
+volatile uint16_t I2C_queue[I2C_QUEUE_SIZE];      // data byte + flags in the high byte
+volatile uint8_t  I2C_head;                       // write index (main program)
+volatile uint8_t  I2C_tail;                       // read index (interrupt)
+
+#if defined(I2C_BUFFER)
+// I2C render buffers. While the interrupt sends one of them, I2C_write fills
+// the other, so preparing the data (e.g. decoding glyphs) overlaps with the
+// transfer. A byte costs a store instead of a queue entry, the queue only
+// carries start, stop and buffer entries.
+#if !defined(I2C_BUFFER_SIZE)
+#define I2C_BUFFER_SIZE 16                        // bytes per render buffer (max 255)
+#endif
+volatile uint8_t  I2C_buf[2][I2C_BUFFER_SIZE];    // the two render buffers
+uint8_t           I2C_bufsel;                     // buffer being filled (main program)
+uint8_t           I2C_buflen;                     // number of bytes in it
+volatile uint8_t  I2C_bufbusy;                    // bit n set: buffer n is queued or being sent
+const volatile uint8_t *I2C_bufptr;               // next byte to send (interrupt)
+uint8_t           I2C_bufcnt;                     // bytes left in the buffer being sent
+uint8_t           I2C_bufrel;                     // busy bit to clear when it is done
+#endif
+
+// I2C send next entry of the queue, disable interrupt if queue is empty
+void I2C_next(void) {
+  while(1) {
+#if defined(I2C_BUFFER)
+    if(I2C_bufcnt) {                              // render buffer transfer in progress?
+      TWI0.MDATA = *I2C_bufptr++;                 // start sending next byte of the buffer
+      if(!--I2C_bufcnt) I2C_bufbusy &= ~I2C_bufrel; // last byte is in MDATA -> buffer is free
+      return;                                     // interrupt comes when byte is sent
+    }
+#endif
+    if(I2C_tail == I2C_head) break;               // queue is empty -> stop
+    uint16_t entry = I2C_queue[I2C_tail];         // get next entry ...
+    I2C_tail = (I2C_tail + 1) & (I2C_QUEUE_SIZE - 1); // ... and remove it from the queue
+    if(entry & I2C_QUEUE_STOP) {                  // stop condition?
+      TWI0.MCTRLB = TWI_MCMD_STOP_gc;             // send stop, no interrupt will follow
+      continue;                                   // -> go on with next entry
+    }
+#if defined(I2C_BUFFER)
+    if(entry & I2C_QUEUE_BUF) {                   // render buffer?
+      uint8_t n = (entry & I2C_QUEUE_BUF1) ? 1 : 0;
+      I2C_bufptr = I2C_buf[n];                    // send it byte by byte ...
+      I2C_bufcnt = entry;                         // ... low byte is the length
+      I2C_bufrel = 1 << n;                        // release this buffer afterwards
+      continue;
+    }
+#endif
+    if(entry & I2C_QUEUE_START) TWI0.MADDR = entry; // start sending address
+    else                        TWI0.MDATA = entry; // start sending data byte
+    return;                                       // interrupt comes when byte is sent
+  }
+  TWI0.MCTRLA = TWI_ENABLE_bm;                    // queue empty -> disable write interrupt
+}
+
+// I2C master interrupt service routine: last byte was sent, send the next one
+ISR(TWI0_TWIM_vect) {
+  I2C_next();
+}
+
+// I2C put entry into the queue, start transmission if the queue was idle
+void I2C_put(uint16_t entry) {
+  uint8_t head = (I2C_head + 1) & (I2C_QUEUE_SIZE - 1); // calculate next write index
+  while(head == I2C_tail);                        // wait while queue is full
+  I2C_queue[I2C_head] = entry;                    // write entry into the queue
+  I2C_head = head;                                // update write index
+  cli();                                          // no interrupt while checking state
+  if(!(TWI0.MCTRLA & TWI_WIEN_bm)) {              // transmission idle?
+    TWI0.MCTRLA = TWI_ENABLE_bm | TWI_WIEN_bm;    // enable write interrupt
+    I2C_next();                                   // start sending
+  }
+  sei();                                          // enable interrupts again
+}
+
+#if defined(I2C_BUFFER)
+// I2C queue the render buffer being filled and switch to the other one
+void I2C_bufqueue(void) {
+  if(!I2C_buflen) return;                         // nothing in the buffer
+  cli();                                          // the interrupt clears busy bits
+  I2C_bufbusy |= 1 << I2C_bufsel;                 // buffer is in use until it is sent
+  sei();
+  I2C_put(I2C_QUEUE_BUF | (I2C_bufsel ? I2C_QUEUE_BUF1 : 0) | I2C_buflen);
+  I2C_bufsel ^= 1;                                // fill the other buffer next
+  I2C_buflen  = 0;
+}
+#else
+#define I2C_bufqueue()
+#endif
+
+// I2C wait until the queue is empty and the last transfer is complete
+void I2C_flush(void) {
+  I2C_bufqueue();                                 // send what is in the render buffer
+  while(TWI0.MCTRLA & TWI_WIEN_bm);               // wait for queue to run empty
+}
+
+// I2C start transmission
+void I2C_start(uint8_t addr) {
+  PERF_START();                                   // count transaction (instrumentation)
+  I2C_bufqueue();                                 // data of the last transaction first
+  I2C_put(I2C_QUEUE_START | addr);                // queue address -> start condition
+}
+
+// I2C stop transmission
+void I2C_stop(void) {
+  I2C_bufqueue();                                 // queue the rest of the data
+  I2C_put(I2C_QUEUE_STOP);                        // queue stop condition
+}
+
+// I2C transmit one data byte to the slave, ignore ACK bit
+void I2C_write(uint8_t data) {
+  PERF_BYTE();                                    // count byte (instrumentation)
+#if defined(I2C_BUFFER)
+  if(!I2C_buflen) while(I2C_bufbusy & (1 << I2C_bufsel)); // wait until buffer was sent
+  I2C_buf[I2C_bufsel][I2C_buflen++] = data;       // put data byte into render buffer
+  if(I2C_buflen == I2C_BUFFER_SIZE) I2C_bufqueue(); // buffer full -> send it
+#else
+  I2C_put(data);                                  // queue data byte
+#endif
+}
+
+#else
+
+// I2C start transmission
+void I2C_start(uint8_t addr) {
+  PERF_START();                                   // count transaction (instrumentation)
+  TWI0.MADDR = addr;                              // start sending address
+}
+
+// I2C stop transmission
+void I2C_stop(void) {
+  while (~TWI0.MSTATUS & TWI_WIF_bm);             // wait for last transfer to complete
+  TWI0.MCTRLB = TWI_MCMD_STOP_gc;                 // send stop condition
+}
+
+// I2C transmit one data byte to the slave, ignore ACK bit
+void I2C_write(uint8_t data) {
+  PERF_BYTE();                                    // count byte (instrumentation)
+  while (~TWI0.MSTATUS & TWI_WIF_bm);             // wait for last transfer to complete
+  TWI0.MDATA = data;                              // start sending data byte
+}
+
+// I2C wait until the last transfer is complete
+void I2C_flush(void) {
+  while (~TWI0.MSTATUS & TWI_WIF_bm);             // wait for last transfer to complete
+}
+
+#endif
+
+// I2C transmit a number of zero bytes to the slave
+void I2C_zeros(uint16_t count) {
+  do I2C_write(0x00); while(--count);             // the TWI does the work
+}
+
+#else
+// -----------------------------------------------------------------------------
+// I2C Master Implementation (Write only) - bit-banging
+// -----------------------------------------------------------------------------
+
+// I2C pins
+#if !defined(I2C_SDA)
+#define I2C_SDA         PB0                   // serial data pin
+#endif
+#if !defined(I2C_SCL)
+#define I2C_SCL         PB2                   // serial clock pin
+#endif
+
+// I2C data pins. With I2C_SDA2 a second OLED has its own data line and shares
+// SCL. Both data pins are switched together for the data bytes, so both OLEDs
+// see the same transfer without rendering or sending anything twice. Only the
+// address byte is sent on each line separately, so the second OLED can keep its
+// own address OLED_ADDR2 (e.g. 0x78 and 0x7A). Only the first OLED acknowledges
+// (I2C_ACKCHECK).
+#if defined(I2C_SDA2)
+#if !defined(OLED_ADDR2)
+#define OLED_ADDR2      (OLED_ADDR ^ 0x02)    // address of the second OLED (other SA0 jumper)
+#endif
+#if (I2C_SDA2 == I2C_SDA) || (I2C_SDA2 == I2C_SCL)
+#error "I2C_SDA2 must be a pin of its own, not I2C_SDA or I2C_SCL!"
+#endif
+#if defined(PERF_PIN) && (I2C_SDA2 == PERF_PIN)
+#error "I2C_SDA2 and PERF_PIN use the same pin (make bench uses PERF_PIN PB1)!"
+#endif
+#if defined(UART_RX) && (I2C_SDA2 == UART_RX)
+#error "I2C_SDA2 and UART_RX use the same pin!"
+#endif
+#define I2C_SDA_MASK    ((1<<I2C_SDA)|(1<<I2C_SDA2))
+#else
+#define I2C_SDA_MASK    (1<<I2C_SDA)
+#endif
+
+// I2C macros
+#define I2C_SDA_HIGH()  DDRB &= ~I2C_SDA_MASK // release SDA   -> pulled HIGH by resistor
+#define I2C_SDA_LOW()   DDRB |=  I2C_SDA_MASK // SDA as output -> pulled LOW  by MCU
+#define I2C_SCL_HIGH()  DDRB &= ~(1<<I2C_SCL) // release SCL   -> pulled HIGH by resistor
+#define I2C_SCL_LOW()   DDRB |=  (1<<I2C_SCL) // SCL as output -> pulled LOW  by MCU
+
+// I2C SCL HIGH delay of the C bit loop. Up to 4 MHz the shift of the data byte
+// is enough; at 8 MHz on the reduced core (1 cycle CBI/SBI) one NOP keeps the
+// HIGH phase at 250ns or more, wherever the compiler puts the shift.
+#if defined(__AVR_TINY__) && F_CPU > 4000000
+#define I2C_DELAY()     asm("nop")            // 1 cycle
+#else
+#define I2C_DELAY()
+#endif
+
+// I2C init function
+void I2C_init(void) {
+  DDRB  &= ~(I2C_SDA_MASK|(1<<I2C_SCL)); // pins as input (HIGH-Z) -> lines released
+  PORTB &= ~(I2C_SDA_MASK|(1<<I2C_SCL)); // should be LOW when as ouput
+}
+
+// I2C transmit the 8 bits of a byte, MSB first (C version, also used for the
+// address byte of a single OLED with I2C_ACKCHECK). Always inlined, so the data
+// bytes do not pay a call and return for sharing it.
+static inline __attribute__((always_inline)) void I2C_bits(uint8_t data) {
+  for(uint8_t i = 8; i; i--) {            // transmit 8 bits, MSB first
+    I2C_SDA_LOW();                        // SDA LOW for now (saves some flash this way)
+    if (data & 0x80) I2C_SDA_HIGH();      // SDA HIGH if bit is 1
+    I2C_SCL_HIGH();                       // clock HIGH -> slave reads the bit
+    I2C_DELAY();                          // SCL HIGH delay at high F_CPU
+    data<<=1;                             // shift left data byte, acts also as a delay
+    I2C_SCL_LOW();                        // clock LOW again
+  }
+}
+
+#if defined(I2C_SDA2)
+// I2C transmit the address byte, MSB first. The second OLED gets its own address
+// on I2C_SDA2, it differs from the one on I2C_SDA in the bits of OLED_ADDR ^
+// OLED_ADDR2.
+void I2C_addr(uint8_t addr) {
+  uint8_t addr2 = addr ^ (OLED_ADDR ^ OLED_ADDR2); // address of the second OLED
+  for(uint8_t i = 8; i; i--) {            // transmit 8 bits, MSB first
+    I2C_SDA_LOW();                        // both SDA LOW for now
+    if (addr  & 0x80) DDRB &= ~(1<<I2C_SDA);  // SDA  HIGH if bit is 1
+    if (addr2 & 0x80) DDRB &= ~(1<<I2C_SDA2); // SDA2 HIGH if bit is 1
+    I2C_SCL_HIGH();                       // clock HIGH -> slaves read the bit
+    I2C_DELAY();                          // SCL HIGH delay at high F_CPU
+    addr <<= 1; addr2 <<= 1;              // next bits, act also as a delay
+    I2C_SCL_LOW();                        // clock LOW again
+  }
+}
+#else
+#define I2C_addr(addr)  I2C_bits(addr)        // one OLED: address like a data byte
+#endif
+
+#if defined(I2C_ASM)
+#if defined(I2C_SDA2)
+#error "I2C_ASM switches a single SDA pin only, use the C version with I2C_SDA2!"
+#endif
+
+// I2C timing contract of the assembly I2C_write. SCL changes at the end of the
+// CBI/SBI instruction, so each phase is the sum of the instructions in between.
+// The limits are what the SSD1306 accepts in practice (nerdralph), the I2C
+// specification asks for 600ns HIGH and 1300ns LOW in fast mode.
+#define I2C_THIGH_MIN   250                   // minimum SCL HIGH time in ns
+#define I2C_TLOW_MIN    500                   // minimum SCL LOW  time in ns
+#if defined(__AVR_TINY__)                     // reduced core (ATtiny10): SBI/CBI = 1 cycle
+#define I2C_CYC_HIGH    2                     // NOP (1) + SBI SCL (1)
+#define I2C_CYC_LOW     4                     // SBI SDA (1) + SBRC/CBI SDA (2) + CBI SCL (1)
+#else                                         // classic core (ATtiny13): SBI/CBI = 2 cycles
+#define I2C_CYC_HIGH    3                     // NOP (1) + SBI SCL (2)
+#define I2C_CYC_LOW     6                     // SBI SDA (2) + SBRC/CBI SDA (2..3) + CBI SCL (2)
+#endif
+#if (I2C_CYC_HIGH * 1000000000ULL / F_CPU) < I2C_THIGH_MIN
+#error "F_CPU too high for I2C_ASM: SCL HIGH phase too short!"
+#endif
+#if (I2C_CYC_LOW  * 1000000000ULL / F_CPU) < I2C_TLOW_MIN
+#error "F_CPU too high for I2C_ASM: SCL LOW phase too short!"
+#endif
+
+// I2C transmit one bit of the data byte (unrolled, MSB first)
+#define I2C_ASM_BIT(n) \
+  "sbi  %[ddr], %[sda]  \n\t"   /* SDA LOW for now                */ \
+  "sbrc %[data], " #n " \n\t"   /* bit n is 1?                    */ \
+  "cbi  %[ddr], %[sda]  \n\t"   /* -> SDA HIGH                    */ \
+  "cbi  %[ddr], %[scl]  \n\t"   /* clock HIGH -> slave reads bit  */ \
+  "nop                  \n\t"   /* SCL HIGH delay                 */ \
+  "sbi  %[ddr], %[scl]  \n\t"   /* clock LOW again                */
+
+// I2C transmit one data byte to the slave, ignore ACK bit, no clock stretching allowed
+void I2C_write(uint8_t data) {
+  PERF_BYTE();                            // count byte (instrumentation)
+  asm volatile (
+    I2C_ASM_BIT(7) I2C_ASM_BIT(6) I2C_ASM_BIT(5) I2C_ASM_BIT(4)
+    I2C_ASM_BIT(3) I2C_ASM_BIT(2) I2C_ASM_BIT(1) I2C_ASM_BIT(0)
+    "cbi  %[ddr], %[sda]  \n\t"   // release SDA for ACK bit of slave
+    "nop                  \n\t"   // SCL LOW delay
+    "nop                  \n\t"   // SCL LOW delay
+    "cbi  %[ddr], %[scl]  \n\t"   // 9th clock pulse is for the ACK bit
+    "nop                  \n\t"   // ACK bit is ignored, just a delay
+    "sbi  %[ddr], %[scl]  \n\t"   // clock LOW again
+    :
+    : [data] "r" (data),
+      [ddr]  "I" (_SFR_IO_ADDR(DDRB)),
+      [sda]  "I" (I2C_SDA),
+      [scl]  "I" (I2C_SCL)
+  );
+}
+
+#else
+
+// I2C transmit one data byte to the slave, ignore ACK bit, no clock stretching allowed
+void I2C_write(uint8_t data) {
+  PERF_BYTE();                            // count byte (instrumentation)
+  I2C_bits(data);                         // transmit 8 bits
+  I2C_SDA_HIGH();                         // release SDA for ACK bit of slave
+  I2C_SCL_HIGH();                         // 9th clock pulse is for the ACK bit
+  asm("nop");                             // ACK bit is ignored, just a delay
+  I2C_SCL_LOW();                          // clock LOW again
+}
+
+#endif
+
+// I2C transmit a number of zero bytes to the slave. SDA stays LOW all the time,
+// also during the ignored ACK bit (the slave can only pull it LOW as well), so
+// only the clock has to be toggled. This is about twice as fast as I2C_write.
+void I2C_zeros(uint16_t count) {
+  I2C_SDA_LOW();                          // SDA LOW for all bits
+  do {
+    PERF_BYTE();                          // count byte (instrumentation)
+    for(uint8_t i = 9; i; i--) {          // 8 data bits + ACK bit
+      I2C_SCL_HIGH();                     // clock HIGH -> slave reads the bit
+      asm("nop");                         // SCL HIGH delay
+      I2C_SCL_LOW();                      // clock LOW again
+    }
+  } while(--count);                       // repeat for all bytes
+  I2C_SDA_HIGH();                         // release SDA again
+}
+
+// I2C stop transmission
+void I2C_stop(void) {
+  I2C_SDA_LOW();                          // prepare SDA for LOW to HIGH transition
+  I2C_SCL_HIGH();                         // stop condition: SCL goes HIGH first
+  I2C_SDA_HIGH();                         // stop condition: SDA goes HIGH second
+}
+
+#if defined(I2C_ACKCHECK)
+
+// I2C bus recovery: a slave that was interrupted in the middle of a byte may
+// hold SDA LOW. Nine clock pulses with SDA released let it finish the byte and
+// see a NACK, the stop condition then resets the bus.
+void I2C_recover(void) {
+  I2C_SDA_HIGH();                         // release SDA
+  for(uint8_t i = 9; i; i--) {            // 9 clock pulses
+    I2C_SCL_HIGH();                       // clock HIGH
+    asm("nop");                           // SCL HIGH delay
+    I2C_SCL_LOW();                        // clock LOW again
+    asm("nop");                           // SCL LOW delay
+  }
+  I2C_stop();                             // stop condition
+}
+
+// I2C start transmission and check the ACK of the slave address, returns 1 if
+// the slave did not answer (the bus is recovered and stopped then). This is
+// the only ACK bit that is read, the data bytes cost no extra cycles.
+uint8_t I2C_start(uint8_t addr) {
+  PERF_START();                           // count transaction (instrumentation)
+  if(!(PINB & (1<<I2C_SDA))) I2C_recover(); // SDA is held LOW by a hung slave
+  I2C_SDA_LOW();                          // start condition: SDA goes LOW first
+  I2C_SCL_LOW();                          // start condition: SCL goes LOW second
+  I2C_addr(addr);                         // transmit the address byte
+  I2C_SDA_HIGH();                         // release SDA for ACK bit of slave
+  __builtin_avr_delay_cycles(F_CPU / 1000000); // give the pull-up 1us to rise
+  I2C_SCL_HIGH();                         // 9th clock pulse is for the ACK bit
+  uint8_t nack = PINB & (1<<I2C_SDA);     // slave pulls SDA LOW to acknowledge
+  I2C_SCL_LOW();                          // clock LOW again
+  if(!nack) return 0;                     // slave answered
+  I2C_recover();                          // no answer: recover the bus
+  return 1;
+}
+
+#else
+
+// I2C start transmission
+void I2C_start(uint8_t addr) {
+  PERF_START();                           // count transaction (instrumentation)
+  I2C_SDA_LOW();                          // start condition: SDA goes LOW first
+  I2C_SCL_LOW();                          // start condition: SCL goes LOW second
+#if defined(I2C_SDA2)
+  PERF_BYTE();                            // count byte (instrumentation)
+  I2C_addr(addr);                         // send the slave addresses
+  I2C_SDA_HIGH();                         // release SDA for ACK bit of slave
+  I2C_SCL_HIGH();                         // 9th clock pulse is for the ACK bit
+  asm("nop");                             // ACK bit is ignored, just a delay
+  I2C_SCL_LOW();                          // clock LOW again
+#else
+  I2C_write(addr);                        // send slave address
+#endif
+}
+
+#endif
+
+// I2C wait until the last transfer is complete (nothing to do when bit-banging)
+void I2C_flush(void) {
+}
+
+#endif
+
+// -----------------------------------------------------------------------------
+// Frame Scheduler (optional)
+// -----------------------------------------------------------------------------
+
+// With FRAME_FPS the MCU sleeps between the frames instead of spinning or
+// waiting in _delay_ms. It is woken up by the watchdog interrupt (ATtiny10/13)
+// or the periodic interrupt of the RTC (ATtiny202). Both only have periods of
+// powers of two, the frame rate is rounded to the nearest one (62, 31, 16, 8,
+// 4, 2 or 1 Hz, ATtiny202: 64, 32, 16, ...). The MCU sleeps in power-down, with
+// PERF_COUNT in idle, so that the timer of the instrumentation keeps running.
+#if defined(FRAME_FPS)
+#include <avr/sleep.h>
+
+#define FRAME_MS        (1000 / FRAME_FPS)    // wanted frame period in ms
+
+#if defined(TWI0)
+// RTC periodic interrupt timer, 32.768 kHz internal oscillator
+#if   FRAME_MS < 22
+#define FRAME_PERIOD    RTC_PERIOD_CYC512_gc  // 15.6 ms
+#define FRAME_TICK_US   15625
+#elif FRAME_MS < 44
+#define FRAME_PERIOD    RTC_PERIOD_CYC1024_gc // 31.3 ms
+#define FRAME_TICK_US   31250
+#elif FRAME_MS < 88
+#define FRAME_PERIOD    RTC_PERIOD_CYC2048_gc // 62.5 ms
+#define FRAME_TICK_US   62500
+#elif FRAME_MS < 177
+#define FRAME_PERIOD    RTC_PERIOD_CYC4096_gc // 125 ms
+#define FRAME_TICK_US   125000
+#elif FRAME_MS < 354
+#define FRAME_PERIOD    RTC_PERIOD_CYC8192_gc // 250 ms
+#define FRAME_TICK_US   250000
+#elif FRAME_MS < 707
+#define FRAME_PERIOD    RTC_PERIOD_CYC16384_gc // 500 ms
+#define FRAME_TICK_US   500000
+#else
+#define FRAME_PERIOD    RTC_PERIOD_CYC32768_gc // 1 s
+#define FRAME_TICK_US   1000000
+#endif
+#else
+// watchdog prescaler, 128 kHz oscillator: 16 ms, doubled with each step
+#if   FRAME_MS < 23
+#define FRAME_WDP       0                     // 16 ms
+#define FRAME_TICK_US   16000
+#elif FRAME_MS < 45
+#define FRAME_WDP       1                     // 32 ms
+#define FRAME_TICK_US   32000
+#elif FRAME_MS < 90
+#define FRAME_WDP       2                     // 64 ms
+#define FRAME_TICK_US   64000
+#elif FRAME_MS < 177
+#define FRAME_WDP       3                     // 125 ms
+#define FRAME_TICK_US   125000
+#elif FRAME_MS < 354
+#define FRAME_WDP       4                     // 250 ms
+#define FRAME_TICK_US   250000
+#elif FRAME_MS < 707
+#define FRAME_WDP       5                     // 500 ms
+#define FRAME_TICK_US   500000
+#else
+#define FRAME_WDP       6                     // 1 s
+#define FRAME_TICK_US   1000000
+#endif
+#endif
+
+#if defined(PERF_COUNT) || defined(UART_RX)
+#define FRAME_SLEEP     SLEEP_MODE_IDLE       // timer keeps running, quick wake-up
+#else
+#define FRAME_SLEEP     SLEEP_MODE_PWR_DOWN   // only the wake-up timer keeps running
+#endif
+
+volatile uint8_t FRAME_tick;                  // set by the wake-up interrupt
+
+#if defined(TWI0)
+// RTC periodic interrupt: next frame is due
+ISR(RTC_PIT_vect) {
+  RTC.PITINTFLAGS = RTC_PI_bm;                // clear interrupt flag
+  FRAME_tick = 1;                             // wake up main loop
+}
+#else
+// Watchdog interrupt: next frame is due
+ISR(WDT_vect) {
+  FRAME_tick = 1;                             // wake up main loop
+}
+#endif
+
+// Frame scheduler init function
+void FRAME_init(void) {
+#if defined(TWI0)
+  RTC.CLKSEL     = RTC_CLKSEL_INT32K_gc;      // 32.768 kHz internal oscillator
+  while(RTC.PITSTATUS);                       // wait until PIT is synchronized
+  RTC.PITINTCTRL = RTC_PI_bm;                 // enable periodic interrupt
+  RTC.PITCTRLA   = FRAME_PERIOD | RTC_PITEN_bm; // start PIT
+#elif defined(__AVR_TINY__)
+  CCP    = 0xD8;                              // write signature to unlock WDTCSR
+  WDTCSR = (1<<WDIE) | FRAME_WDP;             // watchdog interrupt only, no reset
+#else
+  WDTCR  = (1<<WDCE) | (1<<WDE);              // timed sequence to set the prescaler
+  WDTCR  = (1<<WDTIE) | FRAME_WDP;            // watchdog interrupt only, no reset
+#endif
+  set_sleep_mode(FRAME_SLEEP);                // set sleep mode
+  sleep_enable();                             // allow sleeping
+  sei();                                      // enable global interrupts
+}
+
+// Frame scheduler: sleep until the next frame is due. If the frame took longer
+// than the period, the tick is already there and nothing is waited for.
+void FRAME_wait(void) {
+  I2C_flush();                                // TWI queue must be empty before sleeping
+#if defined(TWI0)
+  while((TWI0.MSTATUS & TWI_BUSSTATE_gm) == TWI_BUSSTATE_OWNER_gc); // stop condition out -> idle
+#endif
+  cli();                                      // no tick between check and sleep
+  while(!FRAME_tick) {
+    sei();                                    // SEI and SLEEP are executed atomically
+    sleep_cpu();                              // sleep until an interrupt occurs
+    cli();                                    // other interrupt? -> check again
+  }
+  FRAME_tick = 0;                             // tick is consumed
+  sei();                                      // enable global interrupts again
+}
+
+// Frame scheduler: sleep a number of frames
+void FRAME_sleep(uint16_t frames) {
+  while(frames--) FRAME_wait();               // wait for each frame
+}
+
+// Frame scheduler: sleep for ms milliseconds instead of _delay_ms, rounded up
+// to whole frames (at least one frame for ms > 0)
+#define FRAME_delay(ms) FRAME_sleep(((uint32_t)(ms) * 1000 + FRAME_TICK_US - 1) / FRAME_TICK_US)
+
+#else
+#define FRAME_init()                          // nothing to do
+#define FRAME_wait()                          // run flat out
+#define FRAME_delay(ms) _delay_ms(ms)         // busy waiting
+#endif
+
+// Benchmark build (make bench): no waits between the frames, so the time
+// between two frame markers (PERF_frame) is the rendering cost only
+#if defined(PERF_NODELAY)
+#undef  FRAME_wait
+#undef  FRAME_delay
+#define FRAME_wait()                          // run flat out
+#define FRAME_delay(ms)                       // no pause between the pictures
+#endif
+
+// -----------------------------------------------------------------------------
+// UART Receiver (optional)
+// -----------------------------------------------------------------------------
+
+// With UART_RX characters from a host (8 data bits, no parity, 1 stop bit) are
+// received in an interrupt and kept in a small FIFO, so nothing gets lost while
+// the main loop is busy with the OLED. The ATtiny202 uses its USART (RXD on
+// PA7). The ATtiny10/13 sample the pin in the pin change interrupt; the I2C is
+// stretched meanwhile, which the master may always do. This takes 8.5 of the
+// 10 bit times of each character, so the main loop cannot keep up with a
+// continuous stream: a line clear alone takes several character times.
+// With UART_RTS (ATtiny202: PINx_bm on PORTA) this pin goes HIGH while the FIFO
+// is almost full and during a line clear, connect it to the CTS input of the
+// host. Without it the host has to pause after each line and must not send
+// more characters in a row than fit into the FIFO.
+#if defined(UART_RX)
+#if !defined(UART_BAUD)
+#define UART_BAUD       9600                  // baud rate
+#endif
+#define UART_FIFO       8                     // FIFO size, must be a power of 2
+#define UART_RTS_LEVEL  (UART_FIFO - 3)       // characters that stop the host (it may send 2 more)
+
+volatile uint8_t UART_buf[UART_FIFO];         // received characters
+volatile uint8_t UART_head;                   // next free place, written by the ISR
+volatile uint8_t UART_tail;                   // next character to read
+
+// UART flow control: RTS HIGH -> host must pause, LOW -> host may send
+#if defined(UART_RTS) && defined(TWI0)
+#define UART_RTS_INIT() PORTA.DIRSET = UART_RTS   // RTS pin as output, LOW
+#define UART_RTS_HIGH() PORTA.OUTSET = UART_RTS   // stop the host
+#define UART_RTS_LOW()  PORTA.OUTCLR = UART_RTS   // host may send again
+#elif defined(UART_RTS)
+#if UART_RTS == UART_RX
+#error "UART_RTS needs a pin of its own!"
+#endif
+#define UART_RTS_INIT() DDRB  |=  (1<<UART_RTS)   // RTS pin as output, LOW
+#define UART_RTS_HIGH() PORTB |=  (1<<UART_RTS)   // stop the host
+#define UART_RTS_LOW()  PORTB &= ~(1<<UART_RTS)   // host may send again
+#else
+#define UART_RTS_INIT()
+#define UART_RTS_HIGH()
+#define UART_RTS_LOW()
+#endif
+
+// UART put a received character into the FIFO, drop it if the FIFO is full
+static inline void UART_put(uint8_t ch) {
+  uint8_t head = UART_head;
+  uint8_t next = (head + 1) & (UART_FIFO - 1);
+  if(next == UART_tail) return;               // FIFO is full
+  UART_buf[head] = ch;                        // store character
+  UART_head = next;                           // character is available now
+  if(((next - UART_tail) & (UART_FIFO - 1)) >= UART_RTS_LEVEL) UART_RTS_HIGH(); // almost full
+}
+
+#if defined(TWI0)
+// UART init function
+void UART_init(void) {
+  USART0.BAUD  = (uint16_t)((4UL * F_CPU + UART_BAUD / 2) / UART_BAUD); // 64 * F_CPU / (16 * baud)
+  USART0.CTRLA = USART_RXCIE_bm;              // receive complete interrupt
+  USART0.CTRLB = USART_RXEN_bm;               // enable receiver
+  UART_RTS_INIT();                            // host may send
+  sei();                                      // enable global interrupts
+}
+
+// USART receive complete interrupt
+ISR(USART0_RXC_vect) {
+  UART_put(USART0.RXDATAL);                   // read character (clears the flag)
+}
+#else
+#define UART_BIT        (F_CPU / UART_BAUD)   // cycles per bit
+#define UART_LATENCY    32                    // cycles from the edge to the first delay
+#if (UART_BIT / 2) <= UART_LATENCY
+#error "UART_BAUD too high for the software UART at this F_CPU!"
+#endif
+
+// UART init function
+void UART_init(void) {
+  DDRB  &= ~(1<<UART_RX);                     // RX pin as input ...
+  PORTB |=  (1<<UART_RX);                     // ... with pull-up, line idles HIGH
+  PCMSK |=  (1<<UART_RX);                     // pin change interrupt on RX pin
+  UART_RTS_INIT();                            // host may send
+#if defined(__AVR_TINY__)
+  PCICR |=  (1<<PCIE0);                       // enable pin change interrupt
+#else
+  GIMSK |=  (1<<PCIE);                        // enable pin change interrupt
+#endif
+  sei();                                      // enable global interrupts
+}
+
+// Pin change interrupt: a falling edge is a start bit, receive the character.
+// The bits are sampled in their middle, the ISR returns right after bit 7.
+ISR(PCINT0_vect) {
+  if(PINB & (1<<UART_RX)) return;             // rising edge: nothing to do
+  __builtin_avr_delay_cycles(UART_BIT + UART_BIT / 2 - UART_LATENCY); // middle of bit 0
+  uint8_t ch = 0, i = 8;
+  while(1) {                                  // 8 data bits, LSB first
+    ch >>= 1;                                 // make room for the next bit
+    if(PINB & (1<<UART_RX)) ch |= 0x80;       // sample bit
+    if(!--i) break;                           // bit 7 done, no need to wait
+    __builtin_avr_delay_cycles(UART_BIT - 7); // wait for the next bit (loop: 7 cycles)
+  }
+  UART_put(ch);                               // store character
+#if defined(__AVR_TINY__)
+  PCIFR = (1<<PCIF0);                         // the data bits set the flag again
+#else
+  GIFR  = (1<<PCIF);                          // the data bits set the flag again
+#endif
+}
+#endif
+
+// UART number of characters in the FIFO
+uint8_t UART_available(void) {
+  return (UART_head - UART_tail) & (UART_FIFO - 1);
+}
+
+// UART next character in the FIFO without removing it (0 if there is none)
+char UART_peek(void) {
+  return UART_available() ? UART_buf[UART_tail] : 0;
+}
+
+// UART stop the host during a longer job (e.g. a line clear)
+#define UART_pause()    UART_RTS_HIGH()
+
+// UART let the host send again if the FIFO has room
+void UART_resume(void) {
+  cli();                                      // the ISR may stop the host meanwhile
+  if(UART_available() < UART_RTS_LEVEL) UART_RTS_LOW();
+  sei();
+}
+
+// UART wait for and read the next character
+char UART_read(void) {
+  while(!UART_available());                   // wait for a character
+  uint8_t tail = UART_tail;
+  char ch = UART_buf[tail];                   // read character
+  UART_tail = (tail + 1) & (UART_FIFO - 1);   // free its place
+  UART_resume();                              // room again?
+  return ch;
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// OLED Implementation
+// -----------------------------------------------------------------------------
+
+// OLED definitions
+#define OLED_CMD_MODE   0x00                  // set command mode
+#define OLED_DAT_MODE   0x40                  // set data mode
+#define OLED_CMD_SINGLE 0x80                  // a single command follows (Co = 1)
+
+// OLED start a transmission. With I2C_ACKCHECK the statement skip (return or
+// continue) is executed if the OLED does not answer, which drops the rest of
+// the frame instead of sending it into the void.
+#if defined(I2C_ACKCHECK)
+#define OLED_START(skip) if(I2C_start(OLED_ADDR)) skip
+#else
+#define OLED_START(skip) I2C_start(OLED_ADDR)
+#endif
+
+// OLED init settings. Everything the SSD1306 already has after reset (multiplex
+// 64, alternative COM pins, page addressing, window 0..7, no flip) is left out.
+#if defined(OLED_INIT_LEN)
+extern const uint8_t OLED_INIT_CMD[] OLED_PROGMEM; // defined by the sketch
+#else
+const uint8_t OLED_INIT_CMD[] OLED_PROGMEM = {
+#if OLED_PAGES != 8
+  0xA8, (OLED_PAGES * 8) - 1,             // set multiplex (HEIGHT-1)
+  0xDA, 0x02,                             // set COM pins hardware configuration to sequential
+#endif
+#if OLED_MODE != OLED_PAGE
+  0x20, OLED_MODE,                        // set memory addressing mode
+#if (OLED_PAGE_FIRST != 0) || (OLED_PAGE_LAST != 7)
+  0x22, OLED_PAGE_FIRST, OLED_PAGE_LAST,  // set min and max page
+#endif
+#endif
+#if defined(OLED_FLIP)
+  0xA1, 0xC8,                             // flip the screen
+#endif
+#if defined(OLED_FASTBOOT)
+  0x8D, 0x14                              // enable charge pump, stay dark
+#else
+  0x8D, 0x14,                             // enable charge pump
+  0xAF                                    // switch on OLED
+#endif
+};
+#define OLED_INIT_LEN   sizeof(OLED_INIT_CMD) // number of init bytes
+#endif
+
+// OLED send a sequence of command bytes from program memory
+void OLED_commands(const uint8_t* p, uint8_t len) {
+  OLED_START(return);                     // start transmission to OLED
+  I2C_write(OLED_CMD_MODE);               // set command mode
+  while(len--) I2C_write(OLED_READ(p++)); // send the command bytes
+  I2C_stop();                             // stop transmission
+}
+
+#if defined(OLED_FASTBOOT)
+#include <util/delay.h>
+#if !defined(OLED_BOOT_MS)
+#define OLED_BOOT_MS    20                    // maximum wait for the OLED after power-up
+#endif
+#endif
+
+// OLED init function. With OLED_FASTBOOT the OLED gets just the time its reset
+// needs after power-up instead of a generous fixed delay in the sketch.
+void OLED_init(void) {
+  I2C_init();                             // initialize I2C first
+#if defined(OLED_FASTBOOT) && defined(I2C_ACKCHECK)
+  uint8_t wait = OLED_BOOT_MS;            // poll the OLED until it answers
+  while(I2C_start(OLED_ADDR)) {           // no answer: I2C_start stopped the bus already
+    if(!--wait) break;                    // give up, the init is sent anyway
+    _delay_ms(1);
+  }
+  if(wait) I2C_stop();                    // answered: end the empty transmission
+#elif defined(OLED_FASTBOOT)
+  _delay_ms(OLED_BOOT_MS);                // no ACK check: wait for the reset
+#endif
+  OLED_commands(OLED_INIT_CMD, OLED_INIT_LEN); // send the init settings
+}
+
+// OLED send a single command within a data transaction
+void OLED_command(uint8_t cmd) {
+  I2C_write(OLED_CMD_SINGLE);             // one command byte follows
+  I2C_write(cmd);                         // send the command
+}
+
+// OLED set vertical shift
+void OLED_shift(uint8_t ypos) {
+  OLED_START(return);                     // start transmission to OLED
+  I2C_write(OLED_CMD_MODE);               // set command mode
+  I2C_write(0xD3);                        // vertical shift command
+  I2C_write(ypos);                        // set vertical shift value
+  I2C_stop();                             // stop transmission
+}
+
+// OLED set the cursor
+void OLED_cursor(uint8_t xpos, uint8_t ypos) {
+  OLED_START(return);                     // start transmission to OLED
+  I2C_write(OLED_CMD_MODE);               // set command mode
+  I2C_write(xpos & 0x0F);                 // set low nibble of start column
+  I2C_write(0x10 | (xpos >> 4));          // set high nibble of start column
+  I2C_write(0xB0 | (ypos & 0x07));        // set start page
+  I2C_stop();                             // stop transmission
+}
+
+// OLED switch display on (1) or off (0), the RAM content is kept
+void OLED_power(uint8_t on) {
+  OLED_START(return);                     // start transmission to OLED
+  I2C_write(OLED_CMD_MODE);               // set command mode
+  I2C_write(0xAE | on);                   // display off (0xAE) or on (0xAF)
+  I2C_stop();                             // stop transmission
+}
+
+// OLED switch the display on after the first frame. With OLED_FASTBOOT the init
+// sequence leaves it off, so the garbage RAM content and the clear are never
+// visible and the first picture appears at once.
+#if defined(OLED_FASTBOOT)
+void OLED_ready(void) {
+  static uint8_t on;                      // display already switched on?
+  if(on) return;                          // yes: nothing to do
+  on = 1;                                 // only once
+  OLED_power(1);                          // show the first frame
+}
+#else
+#define OLED_ready()                          // display is on after OLED_init
+#endif
+
+// OLED set contrast, a low value dims the display
+void OLED_contrast(uint8_t val) {
+  OLED_START(return);                     // start transmission to OLED
+  I2C_write(OLED_CMD_MODE);               // set command mode
+  I2C_write(0x81);                        // contrast command
+  I2C_write(val);                         // set contrast value
+  I2C_stop();                             // stop transmission
+}
+
+#if defined(OLED_FASTCLEAR)
+// OLED clear screen settings: a window over the whole screen, so the entire RAM
+// is cleared with one continuous data stream. The cheapest sequence for the
+// layout of the sketch is picked at compile time:
+// - horizontal or vertical addressing with the default window: the window and
+//   the shift reset in one command transaction, then the stream. The zeros do
+//   not care about the order, so the addressing mode is kept.
+// - horizontal or vertical addressing with OLED_PAGE_FIRST/LAST: the same, then
+//   the page window of the init sequence is set again.
+// - page addressing: the page pointer does not advance, so the stream is sent in
+//   horizontal mode, then page mode is set again with the cursor at the upper
+//   left corner. These are three transactions instead of two per page.
+const uint8_t OLED_CLEAR_CMD[] OLED_PROGMEM = {
+#if OLED_MODE == OLED_PAGE
+  0x20, OLED_HORIZONTAL,                  // set horizontal memory addressing mode
+#endif
+  0x21, 0x00, 0x7F,                       // set min and max column
+  0x22, 0x00, (OLED_PAGES - 1),           // set min and max page
+  0xD3, 0x00                              // reset vertical shift
+};
+
+// OLED clear screen settings: back to the addressing of the sketch, if needed
+#if OLED_MODE == OLED_PAGE
+#define OLED_CLEAR_RESTORE
+const uint8_t OLED_CLEAR_END[] OLED_PROGMEM = {
+  0x20, OLED_PAGE,                        // set page addressing mode of sketch
+  0x00, 0x10, 0xB0                        // set cursor at upper left corner
+};
+#elif (OLED_PAGE_FIRST != 0) || (OLED_PAGE_LAST != OLED_PAGES - 1)
+#define OLED_CLEAR_RESTORE
+const uint8_t OLED_CLEAR_END[] OLED_PROGMEM = {
+  0x22, OLED_PAGE_FIRST, OLED_PAGE_LAST   // set window of the init sequence
+};
+#endif
+
+// OLED clear screen
+void OLED_clear(void) {
+  OLED_commands(OLED_CLEAR_CMD, sizeof(OLED_CLEAR_CMD)); // set full-screen window
+  OLED_START(return);                     // start transmission to OLED
+  I2C_write(OLED_DAT_MODE);               // set data mode
+  I2C_zeros(128 * OLED_PAGES);            // clear the whole RAM in one go
+  I2C_stop();                             // stop transmission
+#if defined(OLED_CLEAR_RESTORE)
+  OLED_commands(OLED_CLEAR_END, sizeof(OLED_CLEAR_END)); // restore addressing
+#endif
+}
+#else
+// OLED clear screen
+void OLED_clear(void) {
+#if OLED_MODE == OLED_PAGE
+  for (uint8_t i = 0; i < OLED_PAGES; i++) { // page mode: clear screen page by page
+    OLED_cursor(0, i);                    // set cursor at start of page
+    OLED_START(return);                   // start transmission to OLED
+    I2C_write(OLED_DAT_MODE);             // set data mode
+    I2C_zeros(128);                       // clear the page
+    I2C_stop();                           // stop transmission
+  }
+#else
+  OLED_cursor(0, 0);                      // set cursor at upper left corner
+  OLED_START(return);                     // start transmission to OLED
+  I2C_write(OLED_DAT_MODE);               // set data mode
+  I2C_zeros(128 * OLED_PAGES);            // clear the screen, RAM pointer wraps around
+  I2C_stop();                             // stop transmission
+#endif
+  OLED_shift(0);                          // reset vertical shift
+}
+#endif
+
+#if defined(OLED_BLOCK) || defined(OLED_SPRITE)
+// OLED area settings: back to the addressing mode and window of the sketch
+const uint8_t OLED_AREA_END[] OLED_PROGMEM = {
+  0x20, OLED_MODE,                        // set memory addressing mode of sketch
+  0x21, 0x00, 0x7F,                       // set min and max column
+  0x22, OLED_PAGE_FIRST, OLED_PAGE_LAST   // set min and max page
+};
+
+// OLED set a window from column x0 to x1 and page p0 to p1 in vertical
+// addressing mode. The following data fills it column by column, from the top
+// page to the bottom page, and nothing outside of it is touched.
+void OLED_area(uint8_t x0, uint8_t x1, uint8_t p0, uint8_t p1) {
+  OLED_START(return);                     // start transmission to OLED
+  I2C_write(OLED_CMD_MODE);               // set command mode
+  I2C_write(0x20);                        // set addressing mode ...
+  I2C_write(OLED_VERTICAL);               // ... to vertical
+  I2C_write(0x21);                        // set min and max column
+  I2C_write(x0);
+  I2C_write(x1);
+  I2C_write(0x22);                        // set min and max page
+  I2C_write(p0);
+  I2C_write(p1);
+  I2C_stop();                             // stop transmission
+}
+#endif
+
+#if defined(OLED_SPRITE)
+// -----------------------------------------------------------------------------
+// OLED Sprites
+// -----------------------------------------------------------------------------
+
+// A sprite is a table in program memory (ATtiny202: anywhere): width in columns,
+// height in pages, then the columns from left to right, each one from the top
+// page to the bottom page with bit 0 as the upper pixel, like the font glyphs.
+
+// OLED draw a sprite with its upper left corner at column xpos and pixel row
+// ypos. Only its bounding box is sent, one page more if ypos is not a multiple
+// of 8. Page-aligned sprites are streamed straight from flash, otherwise each
+// column is split across the pages like the lines of the sine wave renderer.
+// Parts beyond the right or bottom edge of the screen are left out.
+void OLED_sprite(uint8_t xpos, uint8_t ypos, const uint8_t* spr) {
+  uint8_t width = OLED_READ(spr++);       // read width of sprite
+  uint8_t pages = OLED_READ(spr++);       // read height of sprite
+  uint8_t page  = ypos >> 3;              // first page on screen
+  uint8_t sh    = ypos & 7;               // pixel offset within the page
+  uint8_t rows  = pages + (sh != 0);      // number of pages on screen
+  if((xpos > 127) || (page >= OLED_PAGES)) return; // completely off the screen
+  if(width > 128 - xpos) width = 128 - xpos; // clip at the right edge
+  if(rows > OLED_PAGES - page) rows = OLED_PAGES - page; // clip at the bottom
+  if(!width) return;                      // nothing to draw
+
+  OLED_area(xpos, xpos + width - 1, page, page + rows - 1); // bounding box
+  OLED_START(return);                     // start transmission to OLED
+  I2C_write(OLED_DAT_MODE);               // set data mode
+  do {
+    if(!sh) {                             // page-aligned: stream the column
+      for(uint8_t p=0; p<rows; p++) I2C_write(OLED_READ(spr + p));
+    } else {                              // shifted: split across two pages each
+      uint8_t carry = 0;                  // lower part of the page byte above
+      for(uint8_t p=0; p<rows; p++) {
+        uint16_t ln = (p < pages) ? OLED_READ(spr + p) : 0; // read page byte of column
+        ln <<= sh;                        // shift line down to the pixel row
+        I2C_write(ln | carry);            // upper part joins the part above
+        carry = ln >> 8;                  // lower part goes to the next page
+      }
+    }
+    spr += pages;                         // next column of sprite
+  } while(--width);                       // repeat for all columns
+  I2C_stop();                             // stop transmission
+  OLED_commands(OLED_AREA_END, sizeof(OLED_AREA_END)); // restore addressing mode
+}
+
+// OLED fill a box of width columns and pages pages from column xpos and page
+// ypos with a pattern byte, e.g. 0x00 to erase where a sprite has been or 0x7E
+// for a progress bar
+void OLED_fill(uint8_t xpos, uint8_t ypos, uint8_t width, uint8_t pages, uint8_t val) {
+  if(!width || !pages) return;            // nothing to fill
+  OLED_area(xpos, xpos + width - 1, ypos, ypos + pages - 1); // box
+  OLED_START(return);                     // start transmission to OLED
+  I2C_write(OLED_DAT_MODE);               // set data mode
+  do {
+    for(uint8_t p=pages; p; p--) I2C_write(val); // one column of the box
+  } while(--width);                       // repeat for all columns
+  I2C_stop();                             // stop transmission
+  OLED_commands(OLED_AREA_END, sizeof(OLED_AREA_END)); // restore addressing mode
+}
+#endif
+
+#if defined(OLED_PRINT)
+// -----------------------------------------------------------------------------
+// OLED Text
+// -----------------------------------------------------------------------------
+
+#if defined(OLED_FONT_HEADER)
+#include "oled_font.h"                    // font variant generated by fontgen
+#else
+#define OLED_FONT_FIRST 0x20                  // first character in font
+#define OLED_FONT_LAST  0x5F                  // last character in font
+
+// Standard ASCII 5x8 font (adapted from Neven Boyanov and Stephen Denne)
+const uint8_t OLED_FONT[] OLED_PROGMEM = {
+  0x00, 0x00, 0x00, 0x00, 0x00, //   0
+  0x00, 0x00, 0x2f, 0x00, 0x00, // ! 1
+  0x00, 0x07, 0x00, 0x07, 0x00, // " 2
+  0x14, 0x7f, 0x14, 0x7f, 0x14, // # 3
+  0x24, 0x2a, 0x7f, 0x2a, 0x12, // $ 4
+  0x62, 0x64, 0x08, 0x13, 0x23, // % 5
+  0x36, 0x49, 0x55, 0x22, 0x50, // & 6
+  0x00, 0x05, 0x03, 0x00, 0x00, // ' 7
+  0x00, 0x1c, 0x22, 0x41, 0x00, // ( 8
+  0x00, 0x41, 0x22, 0x1c, 0x00, // ) 9
+  0x14, 0x08, 0x3E, 0x08, 0x14, // * 10
+  0x08, 0x08, 0x3E, 0x08, 0x08, // + 11
+  0x00, 0x00, 0xA0, 0x60, 0x00, // , 12
+  0x08, 0x08, 0x08, 0x08, 0x08, // - 13
+  0x00, 0x60, 0x60, 0x00, 0x00, // . 14
+  0x20, 0x10, 0x08, 0x04, 0x02, // / 15
+  0x3E, 0x51, 0x49, 0x45, 0x3E, // 0 16
+  0x00, 0x42, 0x7F, 0x40, 0x00, // 1 17
+  0x42, 0x61, 0x51, 0x49, 0x46, // 2 18
+  0x21, 0x41, 0x45, 0x4B, 0x31, // 3 19
+  0x18, 0x14, 0x12, 0x7F, 0x10, // 4 20
+  0x27, 0x45, 0x45, 0x45, 0x39, // 5 21
+  0x3C, 0x4A, 0x49, 0x49, 0x30, // 6 22
+  0x01, 0x71, 0x09, 0x05, 0x03, // 7 23
+  0x36, 0x49, 0x49, 0x49, 0x36, // 8 24
+  0x06, 0x49, 0x49, 0x29, 0x1E, // 9 25
+  0x00, 0x36, 0x36, 0x00, 0x00, // : 26
+  0x00, 0x56, 0x36, 0x00, 0x00, // ; 27
+  0x08, 0x14, 0x22, 0x41, 0x00, // < 28
+  0x14, 0x14, 0x14, 0x14, 0x14, // = 29
+  0x00, 0x41, 0x22, 0x14, 0x08, // > 30
+  0x02, 0x01, 0x51, 0x09, 0x06, // ? 31
+  0x32, 0x49, 0x59, 0x51, 0x3E, // @ 32
+  0x7C, 0x12, 0x11, 0x12, 0x7C, // A 33
+  0x7F, 0x49, 0x49, 0x49, 0x36, // B 34
+  0x3E, 0x41, 0x41, 0x41, 0x22, // C 35
+  0x7F, 0x41, 0x41, 0x22, 0x1C, // D 36
+  0x7F, 0x49, 0x49, 0x49, 0x41, // E 37
+  0x7F, 0x09, 0x09, 0x09, 0x01, // F 38
+  0x3E, 0x41, 0x49, 0x49, 0x7A, // G 39
+  0x7F, 0x08, 0x08, 0x08, 0x7F, // H 40
+  0x00, 0x41, 0x7F, 0x41, 0x00, // I 41
+  0x20, 0x40, 0x41, 0x3F, 0x01, // J 42
+  0x7F, 0x08, 0x14, 0x22, 0x41, // K 43
+  0x7F, 0x40, 0x40, 0x40, 0x40, // L 44
+  0x7F, 0x02, 0x0C, 0x02, 0x7F, // M 45
+  0x7F, 0x04, 0x08, 0x10, 0x7F, // N 46
+  0x3E, 0x41, 0x41, 0x41, 0x3E, // O 47
+  0x7F, 0x09, 0x09, 0x09, 0x06, // P 48
+  0x3E, 0x41, 0x51, 0x21, 0x5E, // Q 49
+  0x7F, 0x09, 0x19, 0x29, 0x46, // R 50
+  0x46, 0x49, 0x49, 0x49, 0x31, // S 51
+  0x01, 0x01, 0x7F, 0x01, 0x01, // T 52
+  0x3F, 0x40, 0x40, 0x40, 0x3F, // U 53
+  0x1F, 0x20, 0x40, 0x20, 0x1F, // V 54
+  0x3F, 0x40, 0x38, 0x40, 0x3F, // W 55
+  0x63, 0x14, 0x08, 0x14, 0x63, // X 56
+  0x07, 0x08, 0x70, 0x08, 0x07, // Y 57
+  0x61, 0x51, 0x49, 0x45, 0x43, // Z 58
+  0x00, 0x7F, 0x41, 0x41, 0x00, // [ 59
+  0x02, 0x04, 0x08, 0x10, 0x20, // \ 60
+  0x00, 0x41, 0x41, 0x7F, 0x00, // ] 61
+  0x04, 0x02, 0x01, 0x02, 0x04, // ^ 62
+  0x40, 0x40, 0x40, 0x40, 0x40  // _ 63
+};
+#endif
+
+// OLED get glyph number of a character
+#if defined(OLED_FONT_SUBSET)
+#define OLED_GLYPH(ch)  OLED_READ(&OLED_FONT_MAP[(ch) - OLED_FONT_FIRST])
+#else
+#define OLED_GLYPH(ch)  ((uint8_t)((ch) - OLED_FONT_FIRST))
+#endif
+
+#if defined(OLED_FONT_PROP)
+#if defined(OLED_FONT_PACKED)
+#error "OLED_FONT_PROP does not support the packed font!"
+#endif
+#if !defined(OLED_SPACE_WIDTH)
+#define OLED_SPACE_WIDTH 3                    // columns of a glyph without pixels
+#endif
+
+uint8_t OLED_width;                       // number of columns of the last glyph
+
+// OLED proportional font: get the position of the first column of a glyph in
+// OLED_FONT and its number of columns in OLED_width. The blank columns on both
+// sides of the glyph are dropped, so no width table is needed in flash.
+uint16_t OLED_glyph(char ch) {
+  uint16_t offset = OLED_GLYPH(ch);       // number of glyph in font
+  offset += offset << 2;                  // -> offset = glyph * 5
+  uint8_t  w = 5;                         // glyph consists of 5 columns
+  while(!OLED_READ(&OLED_FONT[offset])) { // skip blank columns on the left
+    offset++;
+    if(!--w) {                            // glyph without pixels (space)?
+      OLED_width = OLED_SPACE_WIDTH;      // fixed width, columns are blank
+      return offset - 5;
+    }
+  }
+  while(!OLED_READ(&OLED_FONT[offset + w - 1])) w--; // drop blank columns on the right
+  OLED_width = w;
+  return offset;
+}
+#endif
+
+// OLED print a character, returns the number of columns printed
+uint8_t OLED_printC(char ch) {
+#if defined(OLED_FONT_PROP)
+  uint16_t offset = OLED_glyph(ch);       // first column and width of glyph
+  I2C_write(0x00);                        // print spacing between characters
+  for(uint8_t i=OLED_width; i; i--) I2C_write(OLED_READ(&OLED_FONT[offset++])); // print character
+  return OLED_width + 1;
+#else
+  uint8_t  glyph  = OLED_GLYPH(ch);       // number of glyph in font
+#if defined(OLED_FONT_PACKED)             // packed font: two glyphs in 9 bytes, see fontgen
+  uint16_t offset = glyph >> 1;           // calculate position of glyph pair in font array
+  offset += offset << 3;                  // -> offset = (glyph / 2) * 9
+  uint8_t  mid = OLED_READ(&OLED_FONT[offset + 8]); // lower bits of middle columns
+  if(glyph & 1) offset += 4;              // odd glyph: second half, high nibble
+  else mid <<= 4;                         // even glyph: first half, low nibble
+  uint8_t  col[4];                        // outer columns of glyph
+  for(uint8_t i=0; i<4; i++) {
+    col[i] = OLED_READ(&OLED_FONT[offset++]); // read column
+    mid = (mid >> 1) | (col[i] & 0x80);   // collect upper bits of middle column
+  }
+  I2C_write(0x00);                        // print spacing between characters
+  I2C_write(col[0] & 0x7F);               // print character column by column
+  I2C_write(col[1] & 0x7F);
+  I2C_write(mid);
+  I2C_write(col[2] & 0x7F);
+  I2C_write(col[3] & 0x7F);
+#else
+  uint16_t offset = glyph;                // calculate position of character in font array
+  offset += offset << 2;                  // -> offset = glyph * 5
+  I2C_write(0x00);                        // print spacing between characters
+  for(uint8_t i=5; i; i--) I2C_write(OLED_READ(&OLED_FONT[offset++])); // print character
+#endif
+  return 6;
+#endif
+}
+
+// OLED print a string from program memory (ATtiny202: from anywhere)
+void OLED_printP(const char* p) {
+  OLED_START(return);                     // start transmission to OLED
+  I2C_write(OLED_DAT_MODE);               // set data mode
+  char ch = OLED_READ(p);                 // read first character from program memory
+  while (ch != 0) {                       // repeat until string terminator
+    OLED_printC(ch);                      // print character on OLED
+    ch = OLED_READ(++p);                  // read next character
+  }
+  I2C_stop();                             // stop transmission
+}
+
+#if defined(OLED_BATCH)
+// OLED text record for batched printing (table in program memory, last str = NULL)
+typedef struct {
+  uint8_t     xpos;                       // start column
+  uint8_t     ypos;                       // start page
+  const char *str;                        // string in program memory
+} OLED_TEXT;
+
+#define OLED_BATCH_GAP  8                     // max blank columns to fill instead of moving
+
+// OLED print a table of text records from program memory. Each record moves the
+// cursor with single commands inside its own data transaction, so there is one
+// transaction per record instead of two. A record that starts on the same page
+// not more than OLED_BATCH_GAP columns behind the previous one is simply joined
+// by blank columns without starting a new transaction.
+void OLED_printT(const OLED_TEXT *t) {
+  uint8_t xpos = 0xFF, ypos = 0xFF;       // current cursor position (none yet)
+  const char *p;
+  while((p = OLED_READP(&t->str))) {      // repeat until end of table
+    uint8_t x = OLED_READ(&t->xpos);      // read start column of record
+    uint8_t y = OLED_READ(&t->ypos);      // read start page of record
+    if((y != ypos) || (x < xpos) || (x - xpos > OLED_BATCH_GAP)) {
+      if(ypos != 0xFF) I2C_stop();        // stop previous transaction
+      OLED_START(return);                 // start transmission to OLED
+      OLED_command(x & 0x0F);             // set low nibble of start column
+      OLED_command(0x10 | (x >> 4));      // set high nibble of start column
+      OLED_command(0xB0 | (y & 0x07));    // set start page
+      I2C_write(OLED_DAT_MODE);           // set data mode for the rest of transaction
+      xpos = x; ypos = y;                 // cursor is at record start now
+    }
+    for(; xpos < x; xpos++) I2C_write(0x00); // fill gap with blank columns
+    for(char ch; (ch = OLED_READ(p)); p++) xpos += OLED_printC(ch); // print string
+    t++;                                  // next record
+  }
+  if(ypos != 0xFF) I2C_stop();            // stop transmission
+}
+#endif
+
+#if defined(OLED_BLOCK)
+#if defined(OLED_FONT_PACKED)
+#error "OLED_BLOCK does not support the packed font!"
+#endif
+
+// OLED print a block of lines (NULL-terminated table of strings in program
+// memory) at column xpos, one line per page from ypos on. Lines below the last
+// page and characters beyond the right edge of the screen are left out.
+// A window over the block is set in vertical addressing mode, then the block is
+// sent column by column with one byte per line in a single data transaction,
+// without any cursor commands in between. The font needs no conversion for
+// this, each column of a glyph is already one page byte. Shorter lines are
+// filled with spaces. The block is always printed with the fixed-width font.
+void OLED_printV(uint8_t xpos, uint8_t ypos, const char* const* tab) {
+  const char *p[OLED_PAGES];              // current character of each line
+  const char *s;
+  uint8_t lines = 0, width = 0;
+  if(ypos >= OLED_PAGES) return;          // completely off the screen
+  while((lines < OLED_PAGES - ypos) && (s = OLED_READP(&tab[lines]))) { // up to the last page
+    p[lines++] = s;                       // line starts here
+    uint8_t len = 0;
+    while(OLED_READ(s++)) len++;          // get length of line
+    if(len > width) width = len;          // block is as wide as the longest line
+  }
+  if(xpos > 128 - 6) return;              // not a single character fits
+  if(width > (128 - xpos) / 6) width = (128 - xpos) / 6; // clip at the right edge
+  if(!width) return;                      // nothing to print
+
+  OLED_area(xpos, xpos + width * 6 - 1, ypos, ypos + lines - 1); // window over the block
+  OLED_START(return);                     // start transmission to OLED
+  I2C_write(OLED_DAT_MODE);               // set data mode
+  do {
+    I2C_zeros(lines);                     // print spacing between characters
+    for(uint8_t i=0; i<5; i++) {          // character consists of 5 columns
+      for(uint8_t l=0; l<lines; l++) {    // one byte per line
+        char ch = OLED_READ(p[l]);        // read character of this line
+        uint16_t offset = OLED_GLYPH(ch ? ch : ' '); // end of line: space
+        offset += offset << 2;            // -> offset = glyph * 5
+        I2C_write(OLED_READ(&OLED_FONT[offset + i])); // print column of character
+      }
+    }
+    for(uint8_t l=0; l<lines; l++) {
+      if(OLED_READ(p[l])) p[l]++;         // next character, stay at end of line
+    }
+  } while(--width);                       // repeat for all characters
+  I2C_stop();                             // stop transmission
+  OLED_commands(OLED_AREA_END, sizeof(OLED_AREA_END)); // restore addressing mode
+}
+#endif
+
+#if defined(UART_RX)
+// OLED terminal settings: page addressing mode, so that each line is one page
+// and a page can be cleared with 128 bytes without leaving it
+const uint8_t OLED_TERM_CMD[] OLED_PROGMEM = {
+  0x20, OLED_PAGE                         // set page addressing mode
+};
+
+// OLED serial display terminal: print the received text line by line, never
+// returns. As long as characters keep coming they are printed within one data
+// transaction, so the I2C stays busy. A newline or a full line continues on
+// the next line. The lines are kept in the 8 RAM pages as a ring. Once the
+// screen is full, the next page is cleared and the display offset is moved one
+// page on, so the screen scrolls up by one line with a single page write instead
+// of a redraw of all lines.
+// Lower case is printed as upper case, other control characters are ignored,
+// characters beyond the font as spaces.
+void OLED_terminal(void) {
+  uint8_t xpos = 0, ypos = 0;             // cursor of the terminal (RAM page)
+  uint8_t top  = 0;                       // RAM page of the top line on screen
+  UART_init();                            // start receiving
+  OLED_clear();                           // clear screen
+  OLED_commands(OLED_TERM_CMD, sizeof(OLED_TERM_CMD)); // one page per line
+  OLED_cursor(0, 0);                      // start at the upper left corner
+  OLED_ready();                           // display on
+  while(1) {
+    char ch = UART_read();                // wait for the next character
+    if((ch == '\n') || (xpos > 128 - 6)) { // end of line?
+      ypos = (ypos + 1) & 7;              // next page of the ring
+      UART_pause();                       // host must wait during the line clear
+      OLED_cursor(0, ypos);               // set cursor to the new line
+      OLED_START({UART_resume(); continue;}); // start transmission to OLED
+      I2C_write(OLED_DAT_MODE);           // set data mode
+      I2C_zeros(128);                     // clear the line, cursor wraps to its start
+      I2C_stop();                         // stop transmission
+      if(ypos == ((top + OLED_PAGES) & 7)) { // new line is below the screen?
+        top = (top + 1) & 7;              // top line moves out
+        OLED_shift(top << 3);             // scroll up by one line
+      }
+      UART_resume();                      // host may send again
+      xpos = 0;
+      if(ch == '\n') continue;            // newline is done
+    }
+    if(ch < ' ') continue;                // ignore other control characters
+    OLED_START(continue);                 // start transmission to OLED
+    I2C_write(OLED_DAT_MODE);             // set data mode
+    while(1) {
+      if(ch > 0x5F) ch -= 0x20;           // lower case -> upper case
+      if(ch > OLED_FONT_LAST) ch = ' ';   // not in the font
+      xpos += OLED_printC(ch);            // print character
+      ch = UART_peek();                   // more characters for this line?
+      if((ch < ' ') || (xpos > 128 - 6)) break; // no: end transaction
+      UART_read();                        // yes: take it
+    }
+    I2C_stop();                           // stop transmission
+    PERF_frame();                         // text done (instrumentation)
+  }
+}
+#endif
+
+#endif // OLED_PRINT
+
+#endif // TINYOLED_H